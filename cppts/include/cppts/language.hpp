@@ -0,0 +1,64 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace cppts {
+
+/// Node type id of a language. Distinct type so that it does not mix with
+/// child indices.
+struct Symbol {
+  TSSymbol id{0};
+
+  constexpr bool operator==(const Symbol& other) const = default;
+};
+
+/// Field id of a language.
+struct Field {
+  TSFieldId id{0};
+
+  constexpr bool operator==(const Field& other) const = default;
+};
+
+/// Thin wrapper around a tree-sitter language that resolves node type names
+/// to symbol ids and field names to field ids. Resolve the ids once and
+/// compare nodes against them instead of comparing type strings.
+class Language {
+ public:
+  explicit Language(const TSLanguage* language) : m_language{language} {}
+
+  const TSLanguage* language() const { return m_language; }
+
+  Symbol symbol(std::string_view name, bool named = true) const {
+    TSSymbol id = ts_language_symbol_for_name(
+        m_language, name.data(), static_cast<uint32_t>(name.size()), named);
+    if (id == 0) {
+      throw std::invalid_argument{"Unknown node type: " + std::string{name}};
+    }
+    return Symbol{id};
+  }
+
+  Field field(std::string_view name) const {
+    TSFieldId id = ts_language_field_id_for_name(
+        m_language, name.data(), static_cast<uint32_t>(name.size()));
+    if (id == 0) {
+      throw std::invalid_argument{"Unknown field: " + std::string{name}};
+    }
+    return Field{id};
+  }
+
+  const char* name(Symbol symbol) const {
+    return ts_language_symbol_name(m_language, symbol.id);
+  }
+
+  const char* name(Field field) const {
+    return ts_language_field_name_for_id(m_language, field.id);
+  }
+
+ private:
+  const TSLanguage* m_language{nullptr};
+};
+
+}  // namespace cppts
@@ -1,10 +1,15 @@
 #pragma once
 
-#include <range/v3/view.hpp>
+#include "cppts/language.hpp"
+
 #include <tree_sitter/api.h>
 
+#include <iterator>
+#include <limits>
 #include <optional>
 #include <ostream>
+#include <stdexcept>
+#include <string>
 #include <string_view>
 
 namespace cppts {
@@ -12,6 +17,117 @@ namespace cppts {
 class Tree;
 class QueryCursor;
 class Cursor;
+class Node;
+
+/// Half-open byte range [start, end) of a source.
+struct ByteRange {
+  uint32_t start{0};
+  uint32_t end{std::numeric_limits<uint32_t>::max()};
+};
+
+/// Half-open point range [start, end) of a source, with zero based rows and
+/// columns.
+struct PointRange {
+  TSPoint start{0, 0};
+  TSPoint end{std::numeric_limits<uint32_t>::max(),
+              std::numeric_limits<uint32_t>::max()};
+};
+
+/// Range over the children of a node, optionally restricted to named
+/// children, children of one symbol or children of one field. Iteration is
+/// driven by a tree cursor, so visiting all children is linear in their
+/// number and does not allocate per child. The range is single-pass and must
+/// outlive its iterators.
+class ChildRange {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Node;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    explicit iterator(ChildRange& range) : m_range{&range} {}
+
+    Node operator*() const;
+
+    iterator& operator++() {
+      m_range->advance();
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    bool operator==(std::default_sentinel_t) const {
+      return m_range == nullptr || !m_range->m_valid;
+    }
+
+   private:
+    ChildRange* m_range{nullptr};
+  };
+
+  ChildRange(Tree& tree, TSNode parent, bool named, Symbol symbol = {},
+             Field field = {})
+      : m_tree{&tree},
+        m_parent{parent},
+        m_named{named},
+        m_symbol{symbol},
+        m_field{field} {}
+
+  ChildRange(const ChildRange&) = delete;
+  ChildRange& operator=(const ChildRange&) = delete;
+
+  ~ChildRange() {
+    if (m_started) {
+      ts_tree_cursor_delete(&m_cursor);
+    }
+  }
+
+  iterator begin() {
+    if (!m_started) {
+      m_started = true;
+      m_cursor = ts_tree_cursor_new(m_parent);
+      m_valid = ts_tree_cursor_goto_first_child(&m_cursor);
+      skipRejected();
+    }
+    return iterator{*this};
+  }
+
+  std::default_sentinel_t end() const { return {}; }
+
+ private:
+  void advance() {
+    m_valid = ts_tree_cursor_goto_next_sibling(&m_cursor);
+    skipRejected();
+  }
+
+  bool accepted() const {
+    if (m_field.id != 0 &&
+        ts_tree_cursor_current_field_id(&m_cursor) != m_field.id) {
+      return false;
+    }
+    TSNode node = ts_tree_cursor_current_node(&m_cursor);
+    if (m_symbol.id != 0) {
+      return ts_node_symbol(node) == m_symbol.id;
+    }
+    return !m_named || ts_node_is_named(node);
+  }
+
+  void skipRejected() {
+    while (m_valid && !accepted()) {
+      m_valid = ts_tree_cursor_goto_next_sibling(&m_cursor);
+    }
+  }
+
+  Tree* m_tree;
+  TSNode m_parent;
+  TSTreeCursor m_cursor{};
+  bool m_named;
+  Symbol m_symbol;
+  Field m_field;
+  bool m_started{false};
+  bool m_valid{false};
+};
 
 class Node {
  public:
@@ -26,6 +142,12 @@ class Node {
 
   unsigned int length() const { return end() - start(); }
 
+  TSPoint startPoint() const { return ts_node_start_point(m_node); }
+
+  TSPoint endPoint() const { return ts_node_end_point(m_node); }
+
+  ByteRange byteRange() const { return ByteRange{start(), end()}; }
+
   std::string_view str() const;
   std::string ast(size_t indent = 2) const;
 
@@ -34,6 +156,8 @@ class Node {
   Tree& getTree() { return *m_tree; }
 
   QueryCursor query(const std::string& query_string);
+  QueryCursor query(const std::string& query_string, ByteRange range);
+  QueryCursor query(const std::string& query_string, PointRange range);
 
   Cursor cursor();
 
@@ -41,12 +165,19 @@ class Node {
 
   const char* type() const { return ts_node_type(m_node); }
 
+  Symbol symbol() const { return Symbol{ts_node_symbol(m_node)}; }
+
+  bool is(Symbol symbol) const { return ts_node_symbol(m_node) == symbol.id; }
+
   bool isNull() const { return ts_node_is_null(m_node); }
 
   operator bool() const { return !isNull(); }
 
   bool isNamed() const { return ts_node_is_named(m_node); }
 
+  /// Whether the node is an extra like a comment, which can appear anywhere
+  bool isExtra() const { return ts_node_is_extra(m_node); }
+
   Node parent() { return Node{*m_tree, ts_node_parent(m_node)}; }
 
   Node child(uint32_t i) {
@@ -65,6 +196,23 @@ class Node {
     return node;
   }
 
+  Node child(Field field) const {
+    auto node = Node{*m_tree, ts_node_child_by_field_id(m_node, field.id)};
+    if (node.isNull()) {
+      throw std::out_of_range{"No node with field id: " +
+                              std::to_string(field.id)};
+    }
+    return node;
+  }
+
+  std::optional<Node> maybeChild(Field field) const {
+    auto node = Node{*m_tree, ts_node_child_by_field_id(m_node, field.id)};
+    if (node.isNull()) {
+      return std::nullopt;
+    }
+    return node;
+  }
+
   Node namedChild(uint32_t i) {
     if (i >= namedChildCount()) {
       throw std::out_of_range{"Out of range named child index"};
@@ -80,17 +228,21 @@ class Node {
 
   Node prevSibling() { return Node{*m_tree, ts_node_prev_sibling(m_node)}; }
 
-  auto children() {
-    return ranges::iota_view<uint32_t, uint32_t>{0u, childCount()} |
-           ranges::views::transform([&](uint32_t i) { return child(i); });
+  ChildRange children() const { return ChildRange{*m_tree, m_node, false}; }
+
+  ChildRange namedChildren() const {
+    return ChildRange{*m_tree, m_node, true};
+  }
+
+  ChildRange childrenOfType(Symbol symbol) const {
+    return ChildRange{*m_tree, m_node, false, symbol};
   }
 
-  auto namedChildren() {
-    return ranges::iota_view<uint32_t, uint32_t>{0u, namedChildCount()} |
-           ranges::views::transform([&](uint32_t i) { return namedChild(i); });
+  ChildRange childrenOfField(Field field) const {
+    return ChildRange{*m_tree, m_node, false, {}, field};
   }
 
-  std::optional<Node> firstChildOfType(const std::string& type) {
+  std::optional<Node> firstChildOfType(std::string_view type) const {
     for (auto child : children()) {
       if (child.type() == type) {
         return child;
@@ -99,6 +251,15 @@ class Node {
     return std::nullopt;
   }
 
+  std::optional<Node> firstChildOfType(Symbol symbol) const {
+    for (auto child : children()) {
+      if (child.is(symbol)) {
+        return child;
+      }
+    }
+    return std::nullopt;
+  }
+
   Node nextNamedSibling() {
     return Node{*m_tree, ts_node_next_named_sibling(m_node)};
   }
@@ -112,6 +273,54 @@ class Node {
   TSNode m_node;
 };
 
+inline Node ChildRange::iterator::operator*() const {
+  return Node{*m_range->m_tree,
+              ts_tree_cursor_current_node(&m_range->m_cursor)};
+}
+
+/// Children of a node wrapped in the node wrapper T, which provides its
+/// symbol as T::symbol and is constructible from a Node.
+template <typename T>
+class TypedChildRange {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    explicit iterator(ChildRange::iterator it) : m_it{it} {}
+
+    T operator*() const { return T{*m_it}; }
+
+    iterator& operator++() {
+      ++m_it;
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    bool operator==(std::default_sentinel_t s) const { return m_it == s; }
+
+   private:
+    ChildRange::iterator m_it;
+  };
+
+  explicit TypedChildRange(const Node& parent)
+      : m_range{parent.childrenOfType(T::symbol)} {}
+
+  TypedChildRange(const Node& parent, Field field)
+      : m_range{parent.childrenOfField(field)} {}
+
+  iterator begin() { return iterator{m_range.begin()}; }
+
+  std::default_sentinel_t end() const { return {}; }
+
+ private:
+  ChildRange m_range;
+};
+
 inline std::ostream& operator<<(std::ostream& os, const Node& node) {
   os << node.str();
 
@@ -2,8 +2,19 @@
 
 #include <tree_sitter/api.h>
 
+#include <atomic>
+#include <chrono>
+#include <span>
+#include <stdexcept>
+
 namespace cppts {
 
+/// Thrown when parsing was cancelled or ran out of time
+class ParseAborted : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
 class Parser {
  public:
   explicit Parser(const TSLanguage* language) : m_language{language} {
@@ -16,6 +27,36 @@ class Parser {
 
   const TSLanguage* language() const { return m_language; }
 
+  /// Abort parses taking longer than `timeout`. Zero disables the limit.
+  void setTimeout(std::chrono::microseconds timeout) {
+    ts_parser_set_timeout_micros(m_parser,
+                                 static_cast<uint64_t>(timeout.count()));
+  }
+
+  std::chrono::microseconds timeout() const {
+    return std::chrono::microseconds{ts_parser_timeout_micros(m_parser)};
+  }
+
+  /// Abort parses as soon as `*flag` becomes non-zero. The flag has to
+  /// outlive all parses, nullptr removes it.
+  void setCancellationFlag(const std::atomic<size_t>* flag) {
+    static_assert(sizeof(std::atomic<size_t>) == sizeof(size_t) &&
+                      std::atomic<size_t>::is_always_lock_free,
+                  "tree-sitter reads the cancellation flag as a size_t");
+    ts_parser_set_cancellation_flag(
+        m_parser, reinterpret_cast<const size_t*>(flag));
+  }
+
+  /// Only parse the text in `ranges`, e.g. code embedded in another
+  /// language. The ranges have to be ordered and must not overlap. No
+  /// ranges include the whole document again.
+  void setIncludedRanges(std::span<const TSRange> ranges) {
+    if (!ts_parser_set_included_ranges(m_parser, ranges.data(),
+                                       static_cast<uint32_t>(ranges.size()))) {
+      throw std::invalid_argument{"Included ranges overlap or are unordered"};
+    }
+  }
+
  private:
   TSParser* m_parser{nullptr};
   const TSLanguage* m_language{nullptr};
@@ -3,11 +3,17 @@
 #include "cppts/node.hpp"
 
 #include <tree_sitter/api.h>
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <regex>
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace cppts {
@@ -16,6 +22,14 @@ class QueryCursor;
 class Node;
 class Tree;
 
+/// Index of a named capture of a query. Obtain it once from Query::capture
+/// and use it to look up captures in matches without comparing names.
+struct CaptureHandle {
+  uint32_t id{0};
+
+  bool operator==(const CaptureHandle& other) const = default;
+};
+
 class Query : public std::enable_shared_from_this<Query> {
  protected:
   Query(const TSLanguage* language, std::string_view query) {
@@ -27,6 +41,16 @@ class Query : public std::enable_shared_from_this<Query> {
     if (error_type != TSQueryErrorNone) {
       throw std::invalid_argument{"Query invalid"};
     }
+
+    uint32_t count = ts_query_capture_count(m_query);
+    m_captureNames.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t length;
+      const char* name = ts_query_capture_name_for_id(m_query, i, &length);
+      m_captureNames.emplace_back(name, length);
+    }
+
+    parsePredicates();
   }
 
  public:
@@ -43,8 +67,54 @@ class Query : public std::enable_shared_from_this<Query> {
 
   QueryCursor exec(Node node);
 
+  uint32_t captureCount() const {
+    return static_cast<uint32_t>(m_captureNames.size());
+  }
+
+  std::optional<CaptureHandle> findCapture(std::string_view name) const {
+    for (uint32_t i = 0; i < m_captureNames.size(); i++) {
+      if (m_captureNames[i] == name) {
+        return CaptureHandle{i};
+      }
+    }
+    return std::nullopt;
+  }
+
+  CaptureHandle capture(std::string_view name) const {
+    if (auto handle = findCapture(name); handle) {
+      return *handle;
+    }
+    throw std::invalid_argument{"Capture with name " + std::string{name} +
+                                " does not exist"};
+  }
+
+  std::string_view captureName(CaptureHandle handle) const {
+    return m_captureNames.at(handle.id);
+  }
+
+  /// Check the text predicates (#eq?, #match?, #any-of? and their not-
+  /// variants) of the pattern of a match against the source the match was
+  /// produced from.
+  bool satisfiesPredicates(const TSQueryMatch& match,
+                           std::string_view source) const;
+
  private:
+  struct Predicate {
+    enum class Kind { Eq, Match, AnyOf };
+
+    Kind kind;
+    bool negated{false};
+    uint32_t capture;
+    std::optional<uint32_t> otherCapture;
+    std::vector<std::string> values;
+    std::optional<std::regex> regex;
+  };
+
+  void parsePredicates();
+
   TSQuery* m_query{nullptr};
+  std::vector<std::string> m_captureNames;
+  std::vector<std::vector<Predicate>> m_predicates;
 };
 
 class Match;
@@ -54,29 +124,93 @@ class Capture {
 
   Node node();
 
+  CaptureHandle handle() const { return CaptureHandle{m_capture.index}; }
+
+  std::string_view name() const;
+
  private:
   Match& m_match;
   const TSQueryCapture& m_capture;
 };
 
+/// Non-allocating range over the captures of a match, in match order.
+class CaptureRange {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Capture;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    iterator(Match& match, const TSQueryCapture* capture)
+        : m_match{&match}, m_capture{capture} {}
+
+    Capture operator*() const { return Capture{*m_match, *m_capture}; }
+
+    iterator& operator++() {
+      ++m_capture;
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    bool operator==(const iterator& other) const {
+      return m_capture == other.m_capture;
+    }
+
+   private:
+    Match* m_match{nullptr};
+    const TSQueryCapture* m_capture{nullptr};
+  };
+
+  CaptureRange(Match& match, const TSQueryCapture* begin,
+               const TSQueryCapture* end)
+      : m_match{&match}, m_begin{begin}, m_end{end} {}
+
+  iterator begin() const { return iterator{*m_match, m_begin}; }
+  iterator end() const { return iterator{*m_match, m_end}; }
+
+  size_t size() const { return static_cast<size_t>(m_end - m_begin); }
+
+ private:
+  Match* m_match;
+  const TSQueryCapture* m_begin;
+  const TSQueryCapture* m_end;
+};
+
+/// A match of a query. Captures are looked up in constant time through the
+/// capture handles of the query while the match is the most recent one of
+/// its cursor, and by scanning the captures otherwise.
 class Match {
  public:
   Match() = default;
   Match(QueryCursor& queryCursor, TSQueryMatch match)
       : m_queryCursor{&queryCursor}, m_match{match} {}
 
+  std::optional<Capture> maybe_capture(CaptureHandle handle);
   std::optional<Capture> maybe_capture(const std::string& name);
 
-  std::vector<std::string> captures();
+  CaptureRange captures() {
+    return CaptureRange{*this, m_match.captures,
+                        m_match.captures + m_match.capture_count};
+  }
 
+  Capture capture(CaptureHandle handle);
   Capture capture(const std::string& name);
 
+  Capture operator[](CaptureHandle handle) { return capture(handle); }
   Capture operator[](const std::string& name);
 
+  bool has(CaptureHandle handle);
   bool has(const std::string& name);
 
   QueryCursor& queryCursor() { return *m_queryCursor; }
 
+  uint32_t id() const { return m_match.id; }
+
+  uint16_t patternIndex() const { return m_match.pattern_index; }
+
  private:
   QueryCursor* m_queryCursor{nullptr};
   TSQueryMatch m_match;
@@ -86,14 +220,56 @@ class QueryCursor {
  public:
   QueryCursor(std::shared_ptr<Query> query, Node& node)
       : m_query{std::move(query)}, m_node{node} {
+    m_slots.resize(m_query->captureCount(), NO_SLOT);
     m_cursor = ts_query_cursor_new();
     ts_query_cursor_exec(m_cursor, m_query->getQuery(), node.getNode());
   }
 
-  ~QueryCursor() { ts_query_cursor_delete(m_cursor); }
+  QueryCursor(const QueryCursor&) = delete;
+  QueryCursor& operator=(const QueryCursor&) = delete;
+
+  QueryCursor(QueryCursor&& other) noexcept
+      : m_query{std::move(other.m_query)},
+        m_slots{std::move(other.m_slots)},
+        m_slotsMatchId{other.m_slotsMatchId},
+        m_node{other.m_node},
+        m_cursor{std::exchange(other.m_cursor, nullptr)} {}
+
+  ~QueryCursor() {
+    if (m_cursor != nullptr) {
+      ts_query_cursor_delete(m_cursor);
+    }
+  }
 
   Query& query() { return *m_query; }
 
+  /// Restrict matches to nodes intersecting a byte range. Restarts the
+  /// cursor.
+  QueryCursor& setByteRange(ByteRange range) {
+    ts_query_cursor_set_byte_range(m_cursor, range.start, range.end);
+    restart();
+    return *this;
+  }
+
+  /// Restrict matches to nodes intersecting a point range. Restarts the
+  /// cursor.
+  QueryCursor& setPointRange(PointRange range) {
+    ts_query_cursor_set_point_range(m_cursor, range.start, range.end);
+    restart();
+    return *this;
+  }
+
+  /// Limit the number of in-progress matches the cursor tracks, to bound
+  /// the work done on huge or pathological inputs.
+  QueryCursor& setMatchLimit(uint32_t limit) {
+    ts_query_cursor_set_match_limit(m_cursor, limit);
+    return *this;
+  }
+
+  bool didExceedMatchLimit() const {
+    return ts_query_cursor_did_exceed_match_limit(m_cursor);
+  }
+
   bool nextMatch(Match& match) {
     if (auto m = nextMatch(); m) {
       match = *m;
@@ -103,24 +279,44 @@ class QueryCursor {
     return false;
   }
 
-  std::optional<Match> nextMatch() {
-    TSQueryMatch _match;
+  std::optional<Match> nextMatch();
 
-    if (!ts_query_cursor_next_match(m_cursor, &_match)) {
+  Node node() { return m_node; }
+
+  /// Position of the first capture with the given handle in the most recent
+  /// match, if that match has the given id.
+  std::optional<uint16_t> slot(uint32_t matchId, CaptureHandle handle) const {
+    if (matchId != m_slotsMatchId || handle.id >= m_slots.size()) {
       return std::nullopt;
     }
-
-    return Match{*this, _match};
+    return m_slots[handle.id];
   }
 
-  Node node() { return m_node; }
+  static constexpr uint16_t NO_SLOT = std::numeric_limits<uint16_t>::max();
 
  private:
+  void restart() {
+    ts_query_cursor_exec(m_cursor, m_query->getQuery(), m_node.getNode());
+    m_slotsMatchId = std::numeric_limits<uint32_t>::max();
+  }
+
   std::shared_ptr<Query> m_query;
+  std::vector<uint16_t> m_slots;
+  uint32_t m_slotsMatchId{std::numeric_limits<uint32_t>::max()};
   Node m_node;
   TSQueryCursor* m_cursor{nullptr};
 };
 
+inline Capture Match::capture(CaptureHandle handle) {
+  if (auto c = maybe_capture(handle); c) {
+    return *c;
+  }
+  throw std::invalid_argument{
+      "Capture with name " +
+      std::string{m_queryCursor->query().captureName(handle)} +
+      " does not exist"};
+}
+
 inline Capture Match::capture(const std::string& name) {
   if (auto c = maybe_capture(name); c) {
     return *c;
@@ -132,33 +328,37 @@ inline Capture Match::operator[](const std::string& name) {
   return capture(name);
 }
 
+inline bool Match::has(CaptureHandle handle) {
+  return maybe_capture(handle).has_value();
+}
+
 inline bool Match::has(const std::string& name) {
   return maybe_capture(name).has_value();
 }
 
-inline std::optional<Capture> Match::maybe_capture(const std::string& name) {
+inline std::optional<Capture> Match::maybe_capture(CaptureHandle handle) {
+  if (auto slot = m_queryCursor->slot(m_match.id, handle); slot) {
+    if (*slot == QueryCursor::NO_SLOT) {
+      return std::nullopt;
+    }
+    return Capture{*this, m_match.captures[*slot]};
+  }
+
+  // not the most recent match of the cursor anymore
   for (uint32_t i = 0; i < m_match.capture_count; i++) {
     const TSQueryCapture& cap = m_match.captures[i];
-    uint32_t caplen;
-    const char* capname = ts_query_capture_name_for_id(
-        m_queryCursor->query().getQuery(), cap.index, &caplen);
-    if (capname == name) {
+    if (cap.index == handle.id) {
       return Capture{*this, cap};
     }
   }
   return std::nullopt;
 }
 
-inline std::vector<std::string> Match::captures() {
-  std::vector<std::string> v;
-  for (uint32_t i = 0; i < m_match.capture_count; i++) {
-    const TSQueryCapture& cap = m_match.captures[i];
-    uint32_t caplen;
-    const char* capname = ts_query_capture_name_for_id(
-        m_queryCursor->query().getQuery(), cap.index, &caplen);
-    v.push_back(capname);
+inline std::optional<Capture> Match::maybe_capture(const std::string& name) {
+  if (auto handle = m_queryCursor->query().findCapture(name); handle) {
+    return maybe_capture(*handle);
   }
-  return v;
+  return std::nullopt;
 }
 
 inline Capture::Capture(Match& match, const TSQueryCapture& capture)
@@ -167,4 +367,8 @@ inline Capture::Capture(Match& match, const TSQueryCapture& capture)
 inline Node Capture::node() {
   return Node{m_match.queryCursor().node().getTree(), m_capture.node};
 }
+
+inline std::string_view Capture::name() const {
+  return m_match.queryCursor().query().captureName(handle());
+}
 }  // namespace cppts
\ No newline at end of file
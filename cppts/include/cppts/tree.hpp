@@ -5,42 +5,116 @@
 #include "cppts/query.hpp"
 
 #include <tree_sitter/api.h>
+
+#include <memory>
+#include <span>
+#include <string>
 #include <string_view>
+#include <utility>
 
 namespace cppts {
 
 class Node;
 
+/// Replacement of the bytes [start, end) of a source by `text`
+struct TextEdit {
+  uint32_t start;
+  uint32_t end;
+  std::string text;
+};
+
+/// Parse tree of a source string.
+///
+/// Copying a tree is cheap: the copy shares the source and the syntax nodes
+/// with the original through reference counting (ts_tree_copy). A single
+/// tree must not be used from several threads at once, but each thread can
+/// work on its own copy concurrently.
 class Tree {
  public:
   Tree(Parser& parser, std::string source)
-      : m_source{std::move(source)}, m_parser{&parser} {
-    m_tree =
-        ts_parser_parse_string(m_parser->parser(), nullptr, m_source.data(),
-                               static_cast<uint32_t>(m_source.size()));
+      : Tree{parser, std::make_shared<const std::string>(std::move(source))} {}
+
+  /// Parse a source the caller shares, without copying it
+  Tree(Parser& parser, std::shared_ptr<const std::string> source)
+      : Tree{parser, std::move(source), nullptr} {}
+
+  /// Parse only the byte ranges `included` of `source`, e.g. code embedded
+  /// in another language. Nodes keep their offsets and points within the
+  /// whole source. No ranges parse the whole source.
+  Tree(Parser& parser, std::string source,
+       std::span<const ByteRange> included)
+      : Tree{parser, std::make_shared<const std::string>(std::move(source)),
+             included} {}
+
+  Tree(Parser& parser, std::shared_ptr<const std::string> source,
+       std::span<const ByteRange> included);
+
+  Tree(const Tree& other)
+      : m_source{other.m_source},
+        m_parser{other.m_parser},
+        m_tree{ts_tree_copy(other.m_tree)} {}
+
+  Tree(Tree&& other) noexcept
+      : m_source{std::move(other.m_source)},
+        m_parser{other.m_parser},
+        m_tree{std::exchange(other.m_tree, nullptr)} {}
+
+  Tree& operator=(Tree other) noexcept {
+    std::swap(m_source, other.m_source);
+    std::swap(m_parser, other.m_parser);
+    std::swap(m_tree, other.m_tree);
+    return *this;
+  }
 
-    if (ts_node_has_error(rootNode().getNode())) {
-      throw std::invalid_argument{"Input source could not be parsed"};
+  ~Tree() {
+    if (m_tree != nullptr) {
+      ts_tree_delete(m_tree);
     }
   }
 
-  Tree(const Tree& other) = default;
-  Tree& operator=(const Tree& other) = default;
+  /// Take a copy of this tree, e.g. to hand it to another thread.
+  Tree copy() const { return Tree{*this}; }
 
-  ~Tree() { ts_tree_delete(m_tree); }
+  /// Parse the source with `edits` applied, reusing the unchanged parts of
+  /// this tree. Edits refer to this tree's source and must not overlap.
+  /// Insertions at the same offset keep their given order, and one may
+  /// precede an edit starting at its offset.
+  Tree edit(Parser& parser, std::span<const TextEdit> edits) const;
 
   Node rootNode();
 
-  std::string_view source() const { return m_source; }
+  std::string_view source() const { return *m_source; }
+
+  /// The source, to share it with other owners
+  const std::shared_ptr<const std::string>& sharedSource() const {
+    return m_source;
+  }
 
   Parser& getParser() { return *m_parser; }
 
+  const TSLanguage* language() const { return ts_tree_language(m_tree); }
+
   QueryCursor query(const std::string& query_string) {
     return rootNode().query(query_string);
   }
 
+  QueryCursor query(const std::string& query_string, ByteRange range) {
+    return rootNode().query(query_string, range);
+  }
+
+  QueryCursor query(const std::string& query_string, PointRange range) {
+    return rootNode().query(query_string, range);
+  }
+
  private:
-  std::string m_source;
+  /// Parse `source`, incrementally if `old` is an edited tree of a previous
+  /// version of it
+  Tree(Parser& parser, std::shared_ptr<const std::string> source,
+       const TSTree* old);
+
+  void parse(const TSTree* old);
+
+  std::shared_ptr<const std::string> m_source;
   Parser* m_parser;
   TSTree* m_tree{nullptr};
 };
@@ -20,14 +20,9 @@ std::string Node::ast(size_t indent) const {
       ss << " ";
     }
     ss << "(" << node.type();
-    if (node.namedChildCount() > 0) {
+    for (auto child : node.namedChildren()) {
       ss << std::endl;
-    }
-    for (uint32_t c = 0; c < node.namedChildCount(); c++) {
-      print(node.namedChild(c), depth + 1);
-      if (c < node.namedChildCount() - 1) {
-        ss << std::endl;
-      }
+      print(child, depth + 1);
     }
     ss << ")";
   };
@@ -38,9 +33,21 @@ std::string Node::ast(size_t indent) const {
 }
 
 QueryCursor Node::query(const std::string& query_string) {
-  auto _query = Query::create(m_tree->getParser().language(), query_string);
+  auto _query = Query::create(m_tree->language(), query_string);
   return _query->exec(*this);
 }
+
+QueryCursor Node::query(const std::string& query_string, ByteRange range) {
+  auto cursor = query(query_string);
+  cursor.setByteRange(range);
+  return cursor;
+}
+
+QueryCursor Node::query(const std::string& query_string, PointRange range) {
+  auto cursor = query(query_string);
+  cursor.setPointRange(range);
+  return cursor;
+}
 Cursor Node::cursor() { return Cursor{*this}; }
 
 bool Node::operator==(const Node& other) const {
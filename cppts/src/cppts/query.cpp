@@ -1,9 +1,165 @@
 #include "cppts/query.hpp"
 
 #include "cppts/node.hpp"
+#include "cppts/tree.hpp"
 
 namespace cppts {
 QueryCursor Query::exec(Node node) {
   return QueryCursor(shared_from_this(), node);
 }
-}  // namespace cppts
\ No newline at end of file
+
+void Query::parsePredicates() {
+  auto stringValue = [&](const TSQueryPredicateStep& step) {
+    uint32_t length;
+    const char* value =
+        ts_query_string_value_for_id(m_query, step.value_id, &length);
+    return std::string{value, length};
+  };
+
+  uint32_t patterns = ts_query_pattern_count(m_query);
+  m_predicates.resize(patterns);
+  for (uint32_t p = 0; p < patterns; p++) {
+    uint32_t length;
+    const TSQueryPredicateStep* steps =
+        ts_query_predicates_for_pattern(m_query, p, &length);
+
+    uint32_t begin = 0;
+    for (uint32_t i = 0; i < length; i++) {
+      if (steps[i].type != TSQueryPredicateStepTypeDone) {
+        continue;
+      }
+      const TSQueryPredicateStep* args = steps + begin;
+      uint32_t nargs = i - begin;
+      begin = i + 1;
+
+      if (nargs == 0 || args[0].type != TSQueryPredicateStepTypeString) {
+        throw std::invalid_argument{"Query predicate without name"};
+      }
+      std::string name = stringValue(args[0]);
+      if (!name.empty() && name.back() == '!') {
+        // directives do not filter matches
+        continue;
+      }
+
+      Predicate predicate;
+      std::string_view op{name};
+      if (op.starts_with("not-")) {
+        predicate.negated = true;
+        op.remove_prefix(4);
+      }
+
+      if (op == "eq?") {
+        predicate.kind = Predicate::Kind::Eq;
+      } else if (op == "match?") {
+        predicate.kind = Predicate::Kind::Match;
+      } else if (op == "any-of?") {
+        predicate.kind = Predicate::Kind::AnyOf;
+      } else {
+        throw std::invalid_argument{"Unsupported query predicate #" + name};
+      }
+
+      if (nargs < 3 || args[1].type != TSQueryPredicateStepTypeCapture) {
+        throw std::invalid_argument{"Predicate #" + name +
+                                    " expects a capture and a value"};
+      }
+      predicate.capture = args[1].value_id;
+
+      for (uint32_t a = 2; a < nargs; a++) {
+        if (args[a].type == TSQueryPredicateStepTypeCapture) {
+          if (predicate.kind != Predicate::Kind::Eq || nargs != 3) {
+            throw std::invalid_argument{"Predicate #" + name +
+                                        " expects string arguments"};
+          }
+          predicate.otherCapture = args[a].value_id;
+        } else {
+          predicate.values.push_back(stringValue(args[a]));
+        }
+      }
+
+      if (predicate.kind != Predicate::Kind::AnyOf && nargs != 3) {
+        throw std::invalid_argument{"Predicate #" + name +
+                                    " expects exactly two arguments"};
+      }
+
+      if (predicate.kind == Predicate::Kind::Match) {
+        predicate.regex.emplace(predicate.values.front());
+      }
+
+      m_predicates[p].push_back(std::move(predicate));
+    }
+  }
+}
+
+bool Query::satisfiesPredicates(const TSQueryMatch& match,
+                                std::string_view source) const {
+  const auto& predicates = m_predicates.at(match.pattern_index);
+  if (predicates.empty()) {
+    return true;
+  }
+
+  auto text = [&](const TSNode& node) {
+    uint32_t start = ts_node_start_byte(node);
+    return source.substr(start, ts_node_end_byte(node) - start);
+  };
+
+  auto holds = [&](const Predicate& predicate, std::string_view value) {
+    switch (predicate.kind) {
+      case Predicate::Kind::Eq:
+        if (predicate.otherCapture) {
+          // compare against every node of the other capture
+          for (uint16_t i = 0; i < match.capture_count; i++) {
+            if (match.captures[i].index == *predicate.otherCapture &&
+                text(match.captures[i].node) != value) {
+              return false;
+            }
+          }
+          return true;
+        }
+        return value == predicate.values.front();
+      case Predicate::Kind::Match:
+        return std::regex_search(value.begin(), value.end(), *predicate.regex);
+      case Predicate::Kind::AnyOf:
+        for (const auto& candidate : predicate.values) {
+          if (value == candidate) {
+            return true;
+          }
+        }
+        return false;
+    }
+    return false;
+  };
+
+  // a predicate has to hold for every node of its capture
+  for (const auto& predicate : predicates) {
+    for (uint16_t i = 0; i < match.capture_count; i++) {
+      const TSQueryCapture& capture = match.captures[i];
+      if (capture.index != predicate.capture) {
+        continue;
+      }
+      if (holds(predicate, text(capture.node)) == predicate.negated) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::optional<Match> QueryCursor::nextMatch() {
+  TSQueryMatch _match;
+
+  std::string_view source = m_node.getTree().source();
+  do {
+    if (!ts_query_cursor_next_match(m_cursor, &_match)) {
+      return std::nullopt;
+    }
+  } while (!m_query->satisfiesPredicates(_match, source));
+
+  std::fill(m_slots.begin(), m_slots.end(), NO_SLOT);
+  for (uint16_t i = _match.capture_count; i-- > 0;) {
+    m_slots[_match.captures[i].index] = i;
+  }
+  m_slotsMatchId = _match.id;
+
+  return Match{*this, _match};
+}
+}  // namespace cppts
@@ -2,6 +2,140 @@
 
 #include "cppts/node.hpp"
 
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
 namespace cppts {
+Tree::Tree(Parser& parser, std::shared_ptr<const std::string> source,
+           const TSTree* old)
+    : m_source{std::move(source)}, m_parser{&parser} {
+  parse(old);
+}
+
+void Tree::parse(const TSTree* old) {
+  m_tree = ts_parser_parse_string(m_parser->parser(), old, m_source->data(),
+                                  static_cast<uint32_t>(m_source->size()));
+
+  if (m_tree == nullptr) {
+    // keep the parser usable for the next source
+    ts_parser_reset(m_parser->parser());
+    throw ParseAborted{"Parsing was cancelled or timed out"};
+  }
+
+  if (ts_node_has_error(ts_tree_root_node(m_tree))) {
+    ts_tree_delete(m_tree);
+    throw std::invalid_argument{"Input source could not be parsed"};
+  }
+}
+
+namespace {
+TSPoint advancePoint(TSPoint point, std::string_view text) {
+  for (char c : text) {
+    if (c == '\n') {
+      point.row++;
+      point.column = 0;
+    } else {
+      point.column++;
+    }
+  }
+  return point;
+}
+}  // namespace
+
+Tree::Tree(Parser& parser, std::shared_ptr<const std::string> source,
+           std::span<const ByteRange> included)
+    : m_source{std::move(source)}, m_parser{&parser} {
+  std::string_view text = *m_source;
+  std::vector<TSRange> ranges;
+  TSPoint point{0, 0};
+  uint32_t offset = 0;
+  for (auto range : included) {
+    if (range.start < offset || range.start > range.end ||
+        range.end > text.size()) {
+      throw std::invalid_argument{"Included ranges out of range or order"};
+    }
+    TSRange& tsRange = ranges.emplace_back();
+    tsRange.start_byte = range.start;
+    tsRange.end_byte = range.end;
+    tsRange.start_point =
+        advancePoint(point, text.substr(offset, range.start - offset));
+    tsRange.end_point = advancePoint(
+        tsRange.start_point, text.substr(range.start, range.end - range.start));
+    point = tsRange.end_point;
+    offset = range.end;
+  }
+
+  parser.setIncludedRanges(ranges);
+  try {
+    parse(nullptr);
+  } catch (...) {
+    parser.setIncludedRanges({});
+    throw;
+  }
+  parser.setIncludedRanges({});
+}
+
+Tree Tree::edit(Parser& parser, std::span<const TextEdit> edits) const {
+  // in source order, edits at the same offset in their given order
+  std::vector<size_t> order(edits.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return std::tie(edits[a].start, a) < std::tie(edits[b].start, b);
+  });
+
+  // one forward pass computes the points of all edits and the new source
+  std::string_view old = *m_source;
+  std::string source;
+  std::vector<TSInputEdit> inputs;
+  inputs.reserve(edits.size());
+  size_t inserted = 0;
+  for (const auto& edit : edits) {
+    inserted += edit.text.size();
+  }
+  source.reserve(old.size() + inserted);
+  uint32_t offset = 0;
+  TSPoint point{0, 0};
+  for (size_t i : order) {
+    const auto& edit = edits[i];
+    if (edit.start < offset || edit.start > edit.end || edit.end > old.size()) {
+      throw std::invalid_argument{"Edits out of range or overlapping"};
+    }
+    auto unchanged = old.substr(offset, edit.start - offset);
+    source.append(unchanged).append(edit.text);
+
+    TSInputEdit& input = inputs.emplace_back();
+    input.start_byte = edit.start;
+    input.old_end_byte = edit.end;
+    input.new_end_byte = edit.start + static_cast<uint32_t>(edit.text.size());
+    input.start_point = advancePoint(point, unchanged);
+    input.old_end_point = advancePoint(
+        input.start_point, old.substr(edit.start, edit.end - edit.start));
+    input.new_end_point = advancePoint(input.start_point, edit.text);
+    offset = edit.end;
+    point = input.old_end_point;
+  }
+  source.append(old.substr(offset));
+
+  // applied back to front, so that the positions of the remaining edits,
+  // which refer to the old source, stay valid
+  TSTree* edited = ts_tree_copy(m_tree);
+  for (auto it = inputs.rbegin(); it != inputs.rend(); ++it) {
+    ts_tree_edit(edited, &*it);
+  }
+
+  try {
+    Tree tree{parser, std::make_shared<const std::string>(std::move(source)),
+              edited};
+    ts_tree_delete(edited);
+    return tree;
+  } catch (...) {
+    ts_tree_delete(edited);
+    throw;
+  }
+}
+
 Node Tree::rootNode() { return Node{*this, ts_tree_root_node(m_tree)}; }
 }  // namespace cppts
\ No newline at end of file
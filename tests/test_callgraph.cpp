@@ -0,0 +1,154 @@
+#include "catch2/catch_all.hpp"
+
+#include "wgsl_reflect/callgraph.hpp"
+#include "wgsl_reflect/layout.hpp"
+
+#include "util.hpp"
+
+#include <stdexcept>
+
+using namespace std::string_literals;
+using wgsl_reflect::DeclarationKind;
+
+namespace {
+const std::string shader = R"WGSL(
+struct View {
+    projection: mat4x4<f32>,
+};
+
+struct Light {
+    color: vec3<f32>,
+};
+
+struct Material {
+    albedo: vec3<f32>,
+};
+
+@group(0) @binding(0) var<uniform> view: View;
+@group(0) @binding(1) var<uniform> lights: Light;
+@group(1) @binding(0) var<uniform> material: Material;
+@group(1) @binding(1) var particles: texture_2d<f32>;
+
+// shading helpers
+fn shade(n: vec3<f32>) -> vec3<f32> {
+    return lights.color * material.albedo;
+}
+
+fn transform(p: vec3<f32>) -> vec4<f32> {
+    return view.projection * vec4<f32>(p, 1.0);
+}
+
+@vertex
+fn vs(@location(0) p: vec3<f32>) -> @builtin(position) vec4<f32> {
+    return transform(p);
+}
+
+@fragment
+fn fs() -> @location(0) vec4<f32> {
+    return vec4<f32>(shade(vec3<f32>(0.0, 0.0, 1.0)), 1.0);
+}
+
+@compute @workgroup_size(64)
+fn cs() {
+    let size = textureDimensions(particles);
+}
+)WGSL";
+
+std::vector<std::string> names(const wgsl_reflect::CallGraph& graph,
+                               const std::vector<size_t>& indices) {
+  std::vector<std::string> result;
+  for (size_t i : indices) {
+    result.push_back(graph.declarations()[i].name);
+  }
+  return result;
+}
+}  // namespace
+
+TEST_CASE("Call graph", "[callgraph]") {
+  wgsl_reflect::Reflect reflect{shader};
+  wgsl_reflect::CallGraph graph{reflect};
+
+  // the comment is not a declaration
+  REQUIRE(graph.declarations().size() == 12);
+  CHECK(graph.declaration("Light").kind == DeclarationKind::Structure);
+  CHECK(graph.declaration("view").kind == DeclarationKind::Variable);
+  CHECK(graph.declaration("vs").kind == DeclarationKind::Function);
+
+  const auto& vs = graph.declaration("vs");
+  CHECK(reflect.source().substr(vs.start, vs.end - vs.start).starts_with(
+      "@vertex"));
+
+  CHECK(graph.calls("vs") == std::vector{"transform"s});
+  CHECK(graph.calls("fs") == std::vector{"shade"s});
+  CHECK(graph.calls("cs").empty());
+
+  CHECK(names(graph, graph.reachable("vs")) ==
+        std::vector{"View"s, "view"s, "transform"s, "vs"s});
+  CHECK(names(graph, graph.reachable("fs")) ==
+        std::vector{"Light"s, "Material"s, "lights"s, "material"s, "shade"s,
+                    "fs"s});
+  CHECK(names(graph, graph.reachable("cs")) ==
+        std::vector{"particles"s, "cs"s});
+
+  CHECK_THROWS_AS(graph.reachable("nope"), std::out_of_range);
+}
+
+TEST_CASE("Bind groups per entry point", "[callgraph]") {
+  wgsl_reflect::Reflect reflect{shader};
+  wgsl_reflect::CallGraph graph{reflect};
+
+  auto vs = graph.bindGroups("vs");
+  REQUIRE(vs.size() == 1);
+  REQUIRE(vs[0].size() == 1);
+  CHECK(vs[0].binding(0)->name == "view");
+
+  auto fs = graph.bindGroups("fs");
+  REQUIRE(fs.size() == 2);
+  CHECK(fs[0].binding(0) == nullptr);
+  CHECK(fs[0].binding(1)->name == "lights");
+  CHECK(fs[1].size() == 1);
+  CHECK(fs[1].binding(0)->name == "material");
+
+  auto cs = graph.bindGroups("cs");
+  REQUIRE(cs.size() == 1);
+  CHECK(cs[0].group() == 1);
+  CHECK(cs[0].binding(1)->name == "particles");
+
+  auto layouts =
+      wgsl_reflect::bindGroupLayouts(cs, wgsl_reflect::ShaderStage::Compute);
+  REQUIRE(layouts.size() == 1);
+  CHECK(layouts[0].group == 1);
+  CHECK(layouts[0].layout.entries().size() == 1);
+  CHECK(layouts[0].layout.entry(1)->resource == "texture_2d");
+}
+
+TEST_CASE("Call graph of the reference shader", "[callgraph]") {
+  wgsl_reflect::Reflect reflect{load_file("reference.wgsl")};
+  wgsl_reflect::CallGraph graph{reflect};
+  auto groups = graph.bindGroups("main");
+  REQUIRE(groups.size() == 1);
+  CHECK(groups[0].binding(0)->name == "viewUniforms");
+  CHECK(groups[0].binding(1)->name == "modelUniforms");
+  CHECK(groups[0].size() == 2);
+}
+
+TEST_CASE("Strip unused declarations", "[callgraph]") {
+  wgsl_reflect::Reflect reflect{shader};
+  wgsl_reflect::CallGraph graph{reflect};
+
+  auto vs = graph.strip("vs");
+  CHECK(vs.find("fn transform") != std::string::npos);
+  CHECK(vs.find("fn shade") == std::string::npos);
+  CHECK(vs.find("shading helpers") == std::string::npos);
+  CHECK(vs.find("struct Light") == std::string::npos);
+
+  wgsl_reflect::Reflect stripped{vs};
+  CHECK(stripped.functions().size() == 2);
+  CHECK(stripped.structures().size() == 1);
+  REQUIRE(stripped.bindGroups().size() == 1);
+  CHECK(stripped.bindGroup(0)->binding(0)->name == "view");
+  CHECK(stripped.vertex(0).fingerprint == reflect.vertex(0).fingerprint);
+
+  // stripping is idempotent
+  CHECK(wgsl_reflect::CallGraph{stripped}.strip("vs") == vs);
+}
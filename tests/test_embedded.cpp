@@ -0,0 +1,111 @@
+#include "catch2/catch_all.hpp"
+
+#include "wgsl_reflect/embedded.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include "util.hpp"
+
+#include <memory>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+namespace {
+std::vector<std::string> regions(const std::string& source,
+                                 wgsl_reflect::HostLanguage language) {
+  std::vector<std::string> result;
+  for (auto range : wgsl_reflect::findEmbeddedWgsl(source, language)) {
+    result.push_back(source.substr(range.start, range.end - range.start));
+  }
+  return result;
+}
+
+const std::string host = R"CPP(#include <string>
+
+// R"wgsl(fn commented() {})wgsl"
+const std::string quoted = "R\"wgsl(fn quoted() {})wgsl\"";
+const std::string shader = R"wgsl(
+struct View {
+    viewProjection: mat4x4<f32>,
+};
+
+@group(0) @binding(3) var<uniform> view: View;
+
+@vertex
+fn main(@location(0) position: vec3<f32>) -> @builtin(position) vec4<f32> {
+    return view.viewProjection * vec4<f32>(position, 1.0);
+}
+)wgsl";
+const std::string glsl = R"glsl(void main() {})glsl";
+)CPP";
+}  // namespace
+
+TEST_CASE("Find embedded WGSL", "[embedded]") {
+  using wgsl_reflect::HostLanguage;
+
+  auto cpp = regions(host, HostLanguage::Cpp);
+  REQUIRE(cpp.size() == 1);
+  CHECK(cpp[0].find("struct View") != std::string::npos);
+
+  CHECK(regions("const a = wgsl`fn a() {}`;\n"
+                "const b = { code: /* wgsl */ `fn b() {}` };\n"
+                "const c = wgsl`fn c() { ${body} }`;\n"
+                "const d = `fn d() {}`;\n",
+                HostLanguage::JavaScript) ==
+        std::vector{"fn a() {}"s, "fn b() {}"s});
+
+  CHECK(regions("# Shader\n\n```wgsl\nfn a() {}\n```\n\n"
+                "````md\n```wgsl\nfn quoted() {}\n```\n````\n\n"
+                "~~~ WGSL\nfn b() {}\n~~~\n",
+                HostLanguage::Markdown) ==
+        std::vector{"fn a() {}\n"s, "fn b() {}\n"s});
+
+  CHECK(wgsl_reflect::hostLanguage("shaders/blur.TS") ==
+        HostLanguage::JavaScript);
+  CHECK(wgsl_reflect::hostLanguage("README.md") == HostLanguage::Markdown);
+  CHECK_FALSE(wgsl_reflect::hostLanguage("blur.wgsl").has_value());
+}
+
+TEST_CASE("Reflect embedded WGSL in place", "[embedded]") {
+  auto ranges = wgsl_reflect::findEmbeddedWgsl(host,
+                                               wgsl_reflect::HostLanguage::Cpp);
+  REQUIRE(ranges.size() == 1);
+  wgsl_reflect::Reflect reflect{host, ranges[0]};
+  wgsl_reflect::Reflect staged{
+      host.substr(ranges[0].start, ranges[0].end - ranges[0].start)};
+
+  CHECK(reflect.source() == host);
+  CHECK(reflect.fingerprint() == staged.fingerprint());
+  REQUIRE(reflect.vertex(0).name == "main");
+
+  // locations refer to the host file
+  auto location = reflect.vertex(0).location;
+  CHECK(host.substr(location.offset, 7) == "@vertex");
+  CHECK(location == wgsl_reflect::locate(host, location.offset));
+  CHECK(location.line == 11);
+  CHECK(reflect.structure("View").location.line == 5);
+
+  const auto* view = reflect.binding("view");
+  REQUIRE(view != nullptr);
+  CHECK(view->binding == 3);
+  CHECK(view->location.line == 9);
+  CHECK(view->location.column == 0);
+
+  wgsl_reflect::Reflect::Options options;
+  options.bindingsOnly = true;
+  wgsl_reflect::Reflect fast{host, ranges[0], options};
+  CHECK(fast.bindGroups()[0].bindings() == reflect.bindGroups()[0].bindings());
+
+  // regions of a shared host hold no copy of it
+  auto shared = std::make_shared<const std::string>(host);
+  wgsl_reflect::Reflect first{shared, ranges[0]};
+  wgsl_reflect::Reflect second{shared, ranges[0], options};
+  CHECK(first.source().data() == shared->data());
+  CHECK(second.source().data() == shared->data());
+  CHECK(first.fingerprint() == reflect.fingerprint());
+
+  CHECK_THROWS_AS(reflect.variant({}), std::logic_error);
+  CHECK_THROWS_AS((wgsl_reflect::Reflect{host, {10, host.size() + 1}}),
+                  std::invalid_argument);
+}
@@ -0,0 +1,93 @@
+#include "catch2/catch_all.hpp"
+
+#include "wgsl_reflect/graph.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include "util.hpp"
+
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+namespace {
+const std::string library = R"WGSL(
+struct VertexInput {
+    @location(0) position: vec3<f32>,
+    @location(1) color: vec3<f32>,
+};
+
+@binding(0) @group(0) var<uniform> view: View;
+)WGSL";
+}  // namespace
+
+TEST_CASE("Module graph", "[graph]") {
+  wgsl_reflect::ModuleGraph graph;
+  graph.add("common", library);
+  graph.add("a", "@vertex fn vs_a(input: VertexInput) {}", {"common"});
+  graph.add("b", "@vertex fn vs_b(input: VertexInput, @location(2) x: f32) {}",
+            {"common"});
+  CHECK(graph.cachedSources() == 3);
+
+  SECTION("Units on their own") {
+    const auto& a = graph.unit("a");
+    CHECK(a.structures().empty());
+    REQUIRE(a.function("vs_a").inputs.size() == 1);
+    CHECK(a.function("vs_a").inputs[0].type == "VertexInput");
+  }
+
+  SECTION("Symbols resolve across units") {
+    auto composed = graph.compose("a");
+    const auto& a = *composed;
+    CHECK(a.structures().size() == 1);
+    REQUIRE(a.vertex(0).inputs.size() == 2);
+    CHECK(a.vertex(0).inputs[1].name == "color");
+    CHECK(a.bindGroup(0)->binding(0)->name == "view");
+    CHECK(graph.compose("a") == composed);
+    // records are shared with the units
+    CHECK(&a.structure("VertexInput") ==
+          &graph.unit("common").structure("VertexInput"));
+
+    auto b = graph.compose("b");
+    REQUIRE(b->vertex(0).inputs.size() == 3);
+    CHECK(b->vertex(0).inputs[2].name == "x");
+
+    // same result as reflecting the concatenation
+    wgsl_reflect::Reflect flat{library +
+                               "@vertex fn vs_a(input: VertexInput) {}"};
+    CHECK(a.vertex(0).fingerprint == flat.vertex(0).fingerprint);
+    CHECK(a.fingerprint() == flat.fingerprint());
+    CHECK(nlohmann::json(a) == nlohmann::json(flat));
+
+    // held compositions outlive changes of the graph
+    graph.remove("a");
+    CHECK(a.vertex(0).name == "vs_a");
+  }
+
+  SECTION("Identical sources are parsed once") {
+    graph.add("c", "@vertex fn vs_a(input: VertexInput) {}", {"common"});
+    CHECK(graph.cachedSources() == 3);
+    CHECK(&graph.unit("c") == &graph.unit("a"));
+
+    graph.remove("a");
+    graph.remove("c");
+    CHECK(graph.cachedSources() == 2);
+  }
+
+  SECTION("Unknown units") {
+    graph.add("d", "fn f() {}", {"missing"});
+    CHECK_THROWS_AS(graph.compose("d"), std::invalid_argument);
+    CHECK_THROWS_AS(graph.unit("missing"), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Module graph of detached reflections", "[graph]") {
+  wgsl_reflect::ModuleGraph graph{{.detach = true}};
+  graph.add("a", "fn a() {}");
+  graph.add("b", "fn a() {}");
+  graph.add("c", "fn c() {}");
+  CHECK(graph.cachedSources() == 2);
+  CHECK(&graph.unit("b") == &graph.unit("a"));
+  CHECK(graph.unit("c").functions()[0].name == "c");
+  CHECK(graph.unit("c").source().empty());
+}
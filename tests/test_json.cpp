@@ -29,4 +29,30 @@ TEST_CASE("Convert to JSON", "[json]") {
     std::stringstream ss;
     ss << j.dump(2) << std::endl;
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("JSON in source order", "[json]") {
+  std::string source = load_file("simple.wgsl");
+  wgsl_reflect::Reflect reflect{source};
+
+  nlohmann::ordered_json j = reflect;
+  std::vector<std::string> structures;
+  for (const auto& [key, _] : j["structures"].items()) {
+    structures.push_back(key);
+  }
+  CHECK(structures == std::vector<std::string>{"VertexInput", "VertexOutput"});
+
+  std::vector<std::string> functions;
+  for (const auto& [key, _] : j["functions"].items()) {
+    functions.push_back(key);
+  }
+  CHECK(functions == std::vector<std::string>{"vs_main", "other", "fs_main"});
+
+  auto attributes = j["functions"]["other"]["attributes"];
+  CHECK(attributes.begin().key() == "compute");
+
+  // identical output regardless of how the model was built
+  wgsl_reflect::Reflect parallel{source, {.threads = 3}};
+  CHECK(nlohmann::ordered_json(parallel).dump() == j.dump());
+  CHECK(nlohmann::json(parallel).dump() == nlohmann::json(reflect).dump());
+}
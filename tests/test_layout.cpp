@@ -0,0 +1,205 @@
+#include "catch2/catch_all.hpp"
+
+#include "wgsl_reflect/layout.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include "util.hpp"
+
+#include <unordered_set>
+
+using namespace std::string_literals;
+using wgsl_reflect::ShaderStage;
+
+TEST_CASE("Bind group layouts", "[layout]") {
+  wgsl_reflect::Reflect reflect{load_file("reference.wgsl")};
+
+  auto layouts = wgsl_reflect::bindGroupLayouts(reflect);
+  REQUIRE(layouts.size() == 2);
+  CHECK(layouts[1].group == 2);
+  CHECK(wgsl_reflect::findLayout(layouts, 1) == nullptr);
+
+  const auto& group0 = layouts[0].layout;
+  REQUIRE(group0.entries().size() == 4);
+  CHECK(group0.entry(0)->resource == "uniform");
+  CHECK(group0.entry(2)->resource == "sampler");
+  CHECK(group0.entry(4)->resource == "texture_2d");
+  CHECK(group0.entry(3) == nullptr);
+  CHECK(group0.entry(0)->visibility == ShaderStage::Vertex);
+
+  CHECK(wgsl_reflect::findLayout(layouts, 2)->entry(0)->resource ==
+        "storage");
+
+  SECTION("Names do not matter") {
+    wgsl_reflect::Reflect other{R"WGSL(
+@group(0) @binding(4) var tex: texture_2d<f32>;
+@group(0) @binding(2) var samp: sampler;
+@group(0) @binding(1) var<uniform> b: B;
+@group(0) @binding(0) var<uniform> a: A;
+@vertex fn vs() {}
+)WGSL"s};
+    auto otherLayouts = wgsl_reflect::bindGroupLayouts(other);
+    CHECK(otherLayouts[0] == layouts[0]);
+    CHECK(otherLayouts[0].layout.hash() == group0.hash());
+
+    std::unordered_set<wgsl_reflect::BindGroupLayout> unique{
+        otherLayouts[0].layout, group0};
+    CHECK(unique.size() == 1);
+
+    auto fragment =
+        wgsl_reflect::bindGroupLayouts(other, ShaderStage::Fragment);
+    CHECK_FALSE(fragment[0] == layouts[0]);
+  }
+
+  CHECK(nlohmann::json(group0)["entries"].size() == 4);
+  CHECK(nlohmann::json(layouts[1])["group"] == 2);
+}
+
+TEST_CASE("Merge bind group layouts", "[layout]") {
+  wgsl_reflect::Reflect vertex{R"WGSL(
+@group(0) @binding(0) var<uniform> view: View;
+@vertex fn vs() {}
+)WGSL"s};
+  wgsl_reflect::Reflect fragment{R"WGSL(
+@group(0) @binding(0) var<uniform> camera: Camera;
+@group(1) @binding(0) var<storage,read_write> data: Data;
+@group(1) @binding(1) var samp: sampler;
+@fragment fn fs() {}
+)WGSL"s};
+
+  std::vector layouts = {wgsl_reflect::bindGroupLayouts(vertex),
+                         wgsl_reflect::bindGroupLayouts(fragment)};
+  auto merged = wgsl_reflect::mergeLayouts(layouts);
+  CHECK(merged.ok());
+  REQUIRE(merged.groups.size() == 2);
+  CHECK(merged.group(0)->entry(0)->visibility ==
+        (ShaderStage::Vertex | ShaderStage::Fragment));
+  CHECK(merged.group(1)->entry(0)->resource == "storage");
+  CHECK(merged.group(1)->entries().size() == 2);
+
+  SECTION("Conflicts") {
+    wgsl_reflect::Reflect compute{R"WGSL(
+@group(1) @binding(1) var tex: texture_2d<f32>;
+@compute @workgroup_size(1) fn cs() {}
+)WGSL"s};
+    layouts.push_back(wgsl_reflect::bindGroupLayouts(compute));
+    auto conflicting = wgsl_reflect::mergeLayouts(layouts);
+    REQUIRE(conflicting.conflicts.size() == 1);
+    CHECK(conflicting.conflicts[0].group == 1);
+    CHECK(conflicting.conflicts[0].binding == 1);
+    CHECK(conflicting.conflicts[0].first == "sampler");
+    CHECK(conflicting.conflicts[0].second == "texture_2d<float>");
+    CHECK(conflicting.group(1)->entry(1)->resource == "sampler");
+  }
+}
+
+TEST_CASE("Texture bind group layouts", "[layout]") {
+  wgsl_reflect::Reflect floats{R"WGSL(
+@group(0) @binding(0) var tex: texture_2d<f32>;
+@group(0) @binding(1) var out: texture_storage_2d<rgba8unorm, write>;
+@fragment fn fs() {}
+)WGSL"s};
+  wgsl_reflect::Reflect uints{R"WGSL(
+@group(0) @binding(0) var tex: texture_2d<u32>;
+@group(0) @binding(1) var out: texture_storage_2d<r32uint, write>;
+@fragment fn fs() {}
+)WGSL"s};
+
+  auto floatLayouts = wgsl_reflect::bindGroupLayouts(floats);
+  auto uintLayouts = wgsl_reflect::bindGroupLayouts(uints);
+  const auto& floatGroup = floatLayouts[0].layout;
+  const auto& uintGroup = uintLayouts[0].layout;
+  const auto* tex = floatGroup.entry(0);
+  CHECK(tex->sampleType == "float");
+  CHECK(tex->viewDimension == "2d");
+  CHECK(uintGroup.entry(0)->sampleType == "uint");
+  CHECK(floatGroup.entry(1)->format == "rgba8unorm");
+  CHECK(floatGroup.entry(1)->access == "write-only");
+
+  CHECK_FALSE(floatGroup == uintGroup);
+  CHECK(floatGroup.hash() != uintGroup.hash());
+
+  std::vector layouts = {floatLayouts, uintLayouts};
+  auto merged = wgsl_reflect::mergeLayouts(layouts);
+  REQUIRE(merged.conflicts.size() == 2);
+  CHECK(merged.conflicts[0].binding == 0);
+  CHECK(merged.conflicts[0].first == "texture_2d<float>");
+  CHECK(merged.conflicts[0].second == "texture_2d<uint>");
+  CHECK(merged.conflicts[1].second ==
+        "texture_storage_2d<r32uint, write-only>");
+}
+
+TEST_CASE("Vertex formats", "[layout]") {
+  using wgsl_reflect::VertexFormat;
+  using wgsl_reflect::vertexFormat;
+  CHECK(vertexFormat("f32") == VertexFormat::Float32);
+  CHECK(vertexFormat("vec3<f32>") == VertexFormat::Float32x3);
+  CHECK(vertexFormat("vec2< u32 >") == VertexFormat::Uint32x2);
+  CHECK(vertexFormat("vec4i") == VertexFormat::Sint32x4);
+  CHECK(vertexFormat("vec4h") == VertexFormat::Float16x4);
+  CHECK(wgsl_reflect::formatName(VertexFormat::Float16x2) == "float16x2");
+  CHECK(wgsl_reflect::formatSize(VertexFormat::Float32x3) == 12);
+  CHECK_THROWS_AS(vertexFormat("mat4x4<f32>"), std::domain_error);
+  CHECK_THROWS_AS(vertexFormat("vec3<f16>"), std::domain_error);
+}
+
+TEST_CASE("Vertex buffer layouts", "[layout]") {
+  wgsl_reflect::Reflect reflect{load_file("reference.wgsl")};
+  const auto& entry = reflect.vertex(0);
+
+  SECTION("Single buffer") {
+    auto layouts = wgsl_reflect::vertexBufferLayouts(entry);
+    REQUIRE(layouts.size() == 1);
+    CHECK(layouts[0].arrayStride == 48);
+    REQUIRE(layouts[0].attributes.size() == 4);
+    CHECK(layouts[0].attributes[1] ==
+          wgsl_reflect::VertexAttribute{wgsl_reflect::VertexFormat::Float32x3,
+                                        12, 1});
+    CHECK(layouts[0].attributes[3].offset == 40);
+
+    auto j = nlohmann::json(layouts[0]);
+    CHECK(j["attributes"][2]["format"] == "float32x4");
+  }
+
+  SECTION("Locations mapped to buffers") {
+    auto layouts = wgsl_reflect::vertexBufferLayouts(entry, {{2, 1}, {3, 1}});
+    REQUIRE(layouts.size() == 2);
+    CHECK(layouts[0].arrayStride == 24);
+    CHECK(layouts[1].arrayStride == 24);
+    CHECK(layouts[1].attributes[0].shaderLocation == 2);
+    CHECK(layouts[1].attributes[0].offset == 0);
+    CHECK(layouts[1].attributes[1].offset == 16);
+  }
+
+  SECTION("Builtins are skipped") {
+    wgsl_reflect::Reflect indexed{R"WGSL(
+@vertex
+fn vs(@builtin(vertex_index) index: u32, @location(0) offset: vec2f,
+      @builtin(instance_index) instance: u32) -> @builtin(position) vec4f {
+  return vec4f(offset, 0.0, 1.0);
+}
+)WGSL"s};
+    auto layouts = wgsl_reflect::vertexBufferLayouts(indexed.vertex(0));
+    REQUIRE(layouts.size() == 1);
+    REQUIRE(layouts[0].attributes.size() == 1);
+    CHECK(layouts[0].attributes[0].shaderLocation == 0);
+    CHECK(layouts[0].arrayStride == 8);
+  }
+
+  SECTION("Attached to vertex entry points") {
+    REQUIRE(entry.vertexBuffers.has_value());
+    CHECK(*entry.vertexBuffers == wgsl_reflect::vertexBufferLayouts(entry));
+    CHECK(nlohmann::json(reflect)["functions"][entry.name]["vertexBuffers"] ==
+          nlohmann::json(*entry.vertexBuffers));
+
+    wgsl_reflect::Reflect matrix{R"WGSL(
+@vertex
+fn vs(@location(0) transform: mat4x4f) -> @builtin(position) vec4f {
+  return transform[3];
+}
+@fragment fn fs() {}
+)WGSL"s};
+    CHECK_FALSE(matrix.vertex(0).vertexBuffers.has_value());
+    CHECK_FALSE(matrix.fragment(0).vertexBuffers.has_value());
+  }
+}
@@ -0,0 +1,114 @@
+#include "catch2/catch_all.hpp"
+
+#include "wgsl_reflect/minify.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include "util.hpp"
+
+using namespace std::string_literals;
+
+namespace {
+const std::string shader = R"WGSL(
+struct Material {
+    albedo: vec3<f32>,
+    roughness: f32,
+};
+
+@group(0) @binding(0) var<uniform> material: Material;
+
+// Lambertian term with a roughness dependent falloff
+fn diffuse(normal: vec3<f32>, direction: vec3<f32>) -> f32 {
+    let falloff = 1.0 - material.roughness;
+    return max(dot(normal, direction), 0.0) * falloff;
+}
+
+@fragment
+fn fs_main(@location(0) normal: vec3<f32>,
+           @builtin(position) position: vec4<f32>) -> @location(0) vec4<f32> {
+    var accumulated = vec3<f32>(0.0, 0.0, 0.0);
+    for (var i = 0; i < 4; i++) {
+        accumulated = accumulated + material.albedo *
+                      diffuse(normal, vec3<f32>(0.0, 0.0, -1.0));
+    }
+    return vec4<f32>(accumulated, 1.0);
+}
+)WGSL";
+
+std::vector<std::string> bindingNames(const wgsl_reflect::Reflect& reflect) {
+  std::vector<std::string> names;
+  for (const auto& group : reflect.bindGroups()) {
+    for (const auto& binding : group.bindings()) {
+      names.push_back(binding.name);
+    }
+  }
+  return names;
+}
+}  // namespace
+
+TEST_CASE("Minify", "[minify]") {
+  wgsl_reflect::Reflect reflect{shader};
+  auto minified = wgsl_reflect::Minifier{}.minify(reflect);
+  const auto& source = minified.source;
+
+  CHECK(source.size() < shader.size() / 2);
+  CHECK(source.find("Lambertian") == std::string::npos);
+  CHECK(source.find('\n') == std::string::npos);
+  CHECK(source.find("accumulated") == std::string::npos);
+  CHECK(source.find("falloff") == std::string::npos);
+  CHECK(source.find("diffuse") == std::string::npos);
+  CHECK(source.find("struct Material") == std::string::npos);
+
+  // interface, members and builtins are kept
+  CHECK(source.find("fn fs_main(") != std::string::npos);
+  CHECK(source.find("@location(0)normal") != std::string::npos);
+  CHECK(source.find("@builtin(position)position") != std::string::npos);
+  CHECK(source.find(".albedo") != std::string::npos);
+  CHECK(source.find("dot(") != std::string::npos);
+  CHECK(minified.entryPoints.empty());
+  CHECK(minified.bindings.empty());
+  CHECK(minified.inputs.empty());
+
+  wgsl_reflect::Reflect again{source};
+  CHECK(bindingNames(again) == bindingNames(reflect));
+  CHECK(again.fragment(0).name == "fs_main");
+  CHECK(again.fragment(0).inputs.size() == 2);
+  CHECK(again.functions().size() == 2);
+}
+
+TEST_CASE("Minify the interface", "[minify]") {
+  wgsl_reflect::Reflect reflect{shader};
+  wgsl_reflect::MinifyOptions options;
+  options.renameEntryPoints = true;
+  options.renameBindings = true;
+  options.renameInputs = true;
+  auto minified = wgsl_reflect::Minifier{options}.minify(reflect);
+
+  REQUIRE(minified.entryPoints.count("fs_main") == 1);
+  REQUIRE(minified.bindings.count("material") == 1);
+  REQUIRE(minified.inputs.count("fs_main") == 1);
+  CHECK(minified.inputs.at("fs_main").size() == 2);
+
+  wgsl_reflect::Reflect again{minified.source};
+  CHECK(again.fragment(0).name == minified.entryPoints.at("fs_main"));
+  CHECK(again.bindGroup(0)->binding(0)->name ==
+        minified.bindings.at("material"));
+  CHECK(again.fragment(0).inputs[0].name ==
+        minified.inputs.at("fs_main").at("normal"));
+
+  nlohmann::json j = minified;
+  CHECK(j["entryPoints"]["fs_main"] == minified.entryPoints.at("fs_main"));
+  CHECK(j["source"] == minified.source);
+}
+
+TEST_CASE("Minify the reference shader", "[minify]") {
+  wgsl_reflect::Reflect reflect{load_file("reference.wgsl")};
+  auto minified = wgsl_reflect::Minifier{}.minify(reflect);
+  wgsl_reflect::Reflect again{minified.source};
+
+  CHECK(bindingNames(again) == bindingNames(reflect));
+  REQUIRE(again.vertex(0).inputs.size() == reflect.vertex(0).inputs.size());
+  for (size_t i = 0; i < again.vertex(0).inputs.size(); i++) {
+    CHECK(again.vertex(0).inputs[i].name == reflect.vertex(0).inputs[i].name);
+  }
+}
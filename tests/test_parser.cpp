@@ -4,14 +4,18 @@
 
 #include "util.hpp"
 
+#include "cppts/language.hpp"
 #include "cppts/node.hpp"
 #include "cppts/parser.hpp"
 #include "cppts/query.hpp"
 #include "cppts/tree.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <stdexcept>
+#include <thread>
 
 using namespace std::string_literals;
 
@@ -209,6 +213,158 @@ TEST_CASE("Query captures", "[parsing]") {
   }
 }
 
+TEST_CASE("Capture handles", "[parsing]") {
+  cppts::Tree tree{parser, load_file("simple.wgsl")};
+
+  auto query = cppts::Query::create(
+      tree_sitter_wgsl(),
+      "(function_declaration (attribute (identifier) @functype)? name: "
+      "(identifier) @funcname) @thefunc");
+
+  CHECK(query->captureCount() == 3);
+  auto funcname = query->capture("funcname");
+  auto functype = query->capture("functype");
+  CHECK(query->captureName(funcname) == "funcname");
+  CHECK_FALSE(query->findCapture("blubb").has_value());
+  CHECK_THROWS_AS(query->capture("blubb"), std::invalid_argument);
+
+  auto cursor = query->exec(tree.rootNode());
+
+  auto a = cursor.nextMatch().value();
+  CHECK(a[funcname].node().str() == "vs_main");
+  CHECK(a[functype].node().str() == "vertex");
+  CHECK(a[funcname].node() == a["funcname"].node());
+  CHECK(a.has(functype));
+
+  std::vector<std::string> names;
+  for (auto capture : a.captures()) {
+    names.emplace_back(capture.name());
+    CHECK(capture.node() == a[capture.handle()].node());
+  }
+  CHECK(a.captures().size() == 3);
+  CHECK(names.size() == 3);
+
+  auto b = cursor.nextMatch().value();
+  CHECK(b[funcname].node().str() == "other");
+  CHECK(b[functype].node().str() == "compute");
+}
+
+TEST_CASE("Range restricted queries", "[parsing]") {
+  cppts::Tree tree{parser, load_file("simple.wgsl")};
+  std::string query_string =
+      "(function_declaration name: (identifier) @funcname)";
+
+  auto names = [](cppts::QueryCursor& cursor) {
+    std::vector<std::string> out;
+    while (auto match = cursor.nextMatch()) {
+      out.emplace_back((*match)["funcname"].node().str());
+    }
+    return out;
+  };
+
+  auto all = tree.query(query_string);
+  CHECK(names(all) == std::vector<std::string>{"vs_main", "other", "fs_main"});
+
+  SECTION("Byte range") {
+    auto src = tree.source();
+    uint32_t start = src.find("@compute");
+    uint32_t end = src.find("// Fragment");
+    auto cursor = tree.query(query_string, cppts::ByteRange{start, end});
+    CHECK(names(cursor) == std::vector<std::string>{"other"});
+  }
+
+  SECTION("Point range") {
+    auto cursor =
+        tree.query(query_string, cppts::PointRange{{27, 0}, {31, 0}});
+    CHECK(names(cursor) == std::vector<std::string>{"fs_main"});
+  }
+
+  SECTION("Restart with another range") {
+    auto cursor = tree.query(query_string);
+    CHECK(cursor.nextMatch().has_value());
+    cursor.setPointRange({{0, 0}, {20, 0}});
+    CHECK(names(cursor) == std::vector<std::string>{"vs_main"});
+  }
+
+  SECTION("Node points") {
+    auto func = tree.rootNode().firstChildOfType("function_declaration");
+    REQUIRE(func.has_value());
+    CHECK(func->startPoint().row == 10);
+    CHECK(func->endPoint().row == 18);
+    CHECK(func->byteRange().start == func->start());
+  }
+
+  SECTION("Match limit") {
+    auto cursor = tree.query(query_string);
+    cursor.setMatchLimit(32);
+    CHECK(names(cursor).size() == 3);
+    CHECK_FALSE(cursor.didExceedMatchLimit());
+  }
+}
+
+TEST_CASE("Query predicates", "[parsing]") {
+  cppts::Tree tree{parser, load_file("reference.wgsl")};
+
+  auto names = [](cppts::QueryCursor& cursor, const std::string& capture) {
+    std::vector<std::string> result;
+    cppts::Match match;
+    while (cursor.nextMatch(match)) {
+      result.emplace_back(match[capture].node().str());
+    }
+    return result;
+  };
+
+  SECTION("eq") {
+    auto cursor = tree.query(R"Q(
+      ((struct_declaration name: (identifier) @name)
+        (#eq? @name "ModelUniforms"))
+    )Q");
+    CHECK(names(cursor, "name") == std::vector<std::string>{"ModelUniforms"});
+  }
+
+  SECTION("not-eq") {
+    auto cursor = tree.query(R"Q(
+      ((struct_declaration name: (identifier) @name)
+        (#not-eq? @name "ModelUniforms"))
+    )Q");
+    CHECK(names(cursor, "name") ==
+          std::vector<std::string>{"ViewUniforms", "VertexInput",
+                                   "VertexOutput"});
+  }
+
+  SECTION("match") {
+    auto cursor = tree.query(R"Q(
+      ((struct_declaration name: (identifier) @name)
+        (#match? @name "^Vertex"))
+    )Q");
+    CHECK(names(cursor, "name") ==
+          std::vector<std::string>{"VertexInput", "VertexOutput"});
+  }
+
+  SECTION("any-of") {
+    auto cursor = tree.query(R"Q(
+      ((struct_declaration name: (identifier) @name)
+        (#any-of? @name "ViewUniforms" "VertexOutput" "Blubb"))
+    )Q");
+    CHECK(names(cursor, "name") ==
+          std::vector<std::string>{"ViewUniforms", "VertexOutput"});
+  }
+
+  SECTION("Globals with a group") {
+    auto cursor = tree.query(R"Q(
+      ((global_variable_declaration (attribute (identifier) @attr)) @global
+        (#eq? @attr "group"))
+    )Q");
+    CHECK(countMatches(cursor) == 5);
+  }
+
+  SECTION("Unsupported predicate") {
+    CHECK_THROWS_AS(
+        tree.query("((identifier) @name (#blubb? @name \"a\"))"),
+        std::invalid_argument);
+  }
+}
+
 TEST_CASE("Multiple attributes", "[parsing]") {
   std::string source = R"WGSL(
     @compute @workgroup_size(8,4,1)
@@ -321,6 +477,33 @@ TEST_CASE("Node navigation", "[parsing]") {
     }
   }
 
+  SECTION("Iterate wide node") {
+    std::string wide = "struct Wide {\n";
+    for (size_t m = 0; m < 500; m++) {
+      wide += "  m" + std::to_string(m) + ": f32,\n";
+    }
+    wide += "};";
+    cppts::Tree wideTree{parser, wide};
+    auto decl = wideTree.rootNode().child(0);
+
+    uint32_t n = 0;
+    for (auto child : decl.namedChildren()) {
+      CHECK(child.isNamed());
+      n++;
+    }
+    CHECK(n == decl.namedChildCount());
+
+    n = 0;
+    for (auto child : decl.children()) {
+      (void)child;
+      n++;
+    }
+    CHECK(n == decl.childCount());
+
+    CHECK(decl.firstChildOfType("struct_member").has_value());
+    CHECK_FALSE(decl.firstChildOfType("attribute").has_value());
+  }
+
   SECTION("Cursor") {
     auto cursor = tree.rootNode().cursor();
     CHECK(cursor.currentNode() == tree.rootNode());
@@ -341,6 +524,158 @@ TEST_CASE("Node navigation", "[parsing]") {
   }
 }
 
+TEST_CASE("Symbol and field ids", "[parsing]") {
+  cppts::Language language{tree_sitter_wgsl()};
+  cppts::Tree tree{parser, "fn other() -> i32 { return 1; }"};
+
+  auto fdecl = language.symbol("function_declaration");
+  auto name = language.field("name");
+
+  CHECK(language.name(fdecl) == "function_declaration"s);
+  CHECK(language.name(name) == "name"s);
+  CHECK_THROWS_AS(language.symbol("blubb"), std::invalid_argument);
+  CHECK_THROWS_AS(language.field("blubb"), std::invalid_argument);
+
+  auto decl = tree.rootNode().child(0);
+  CHECK(decl.symbol() == fdecl);
+  CHECK(decl.is(fdecl));
+  CHECK_FALSE(tree.rootNode().is(fdecl));
+  CHECK(decl.child(name) == decl.child("name"));
+  CHECK(decl.child(name).str() == "other"s);
+  CHECK_THROWS_AS(tree.rootNode().child(name), std::out_of_range);
+
+  auto body = decl.child(language.field("body"));
+  CHECK(decl.firstChildOfType(body.symbol()) == body);
+}
+
+TEST_CASE("Tree copies", "[parser]") {
+  cppts::Tree tree{parser, load_file("simple.wgsl")};
+
+  cppts::Tree copy = tree.copy();
+  CHECK(copy.source().data() == tree.source().data());
+  CHECK(copy.rootNode().namedChildCount() ==
+        tree.rootNode().namedChildCount());
+  CHECK(copy.language() == tree_sitter_wgsl());
+
+  cppts::Tree moved{std::move(copy)};
+  CHECK(moved.rootNode().namedChild(0).type() == "struct_declaration"s);
+
+  copy = moved;
+  CHECK(copy.rootNode().namedChild(0).type() == "struct_declaration"s);
+
+  SECTION("Concurrent queries on per-thread copies") {
+    std::vector<std::vector<std::string>> names(4);
+    std::vector<std::thread> threads;
+    for (auto& out : names) {
+      threads.emplace_back([&out, local = tree.copy()]() mutable {
+        auto cursor = local.query("(function_declaration name: (_) @name)");
+        while (auto match = cursor.nextMatch()) {
+          out.emplace_back((*match)["name"].node().str());
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (const auto& out : names) {
+      CHECK(out == std::vector<std::string>{"vs_main", "other", "fs_main"});
+    }
+  }
+}
+
+TEST_CASE("Incremental edits", "[parser]") {
+  cppts::Tree tree{parser, load_file("simple.wgsl")};
+  auto src = std::string{tree.source()};
+  uint32_t pos = src.find("fn other");
+
+  std::vector<cppts::TextEdit> edits = {
+      {pos + 3, pos + 8, "another"},
+      {0, 6, "struct"},
+  };
+  cppts::Tree edited = tree.edit(parser, edits);
+  CHECK(edited.source().substr(pos, 10) == "fn another");
+  auto func = edited.rootNode().namedChild(3);
+  CHECK(func.type() == "function_declaration"s);
+  auto name = cppts::Language{edited.language()}.field("name");
+  CHECK(func.child(name).str() == "another");
+  // the original tree is untouched
+  CHECK(tree.source().substr(pos, 8) == "fn other");
+
+  CHECK_THROWS_AS(tree.edit(parser, std::vector<cppts::TextEdit>{
+                                        {0, 10, ""}, {5, 12, ""}}),
+                  std::invalid_argument);
+
+  // insertions at the same offset keep their order
+  std::vector<cppts::TextEdit> inserts = {
+      {pos, pos, "// a\n"}, {pos, pos, "// b\n"}, {pos, pos + 8, "fn other"}};
+  CHECK(tree.edit(parser, inserts).source().substr(pos, 18) ==
+        "// a\n// b\nfn other");
+
+  // points of edits adding and removing lines match a fresh parse
+  std::vector<cppts::TextEdit> lines = {
+      {pos + 8, pos + 8, "\n\n"}, {0, 0, "// c\n"}, {pos, pos + 1, "f"}};
+  cppts::Tree multi = tree.edit(parser, lines);
+  cppts::Tree fresh{parser, std::string{multi.source()}};
+  auto points = [](cppts::Tree& t) {
+    std::vector<std::pair<uint32_t, uint32_t>> result;
+    for (auto child : t.rootNode().namedChildren()) {
+      result.emplace_back(child.startPoint().row, child.startPoint().column);
+      result.emplace_back(child.endPoint().row, child.endPoint().column);
+    }
+    return result;
+  };
+  CHECK(points(multi) == points(fresh));
+}
+
+TEST_CASE("Included ranges", "[parser]") {
+  std::string host =
+      "int a = 0;\nauto s = R\"(struct A {\n  x: f32,\n};)\";\n"
+      "auto t = R\"(fn f() {})\";\n";
+  uint32_t first = host.find("struct");
+  uint32_t second = host.find("fn f");
+  std::vector<cppts::ByteRange> ranges = {
+      {first, static_cast<uint32_t>(host.find(")\";"))},
+      {second, static_cast<uint32_t>(host.rfind(")\";"))}};
+
+  cppts::Tree tree{parser, host, ranges};
+  auto root = tree.rootNode();
+  REQUIRE(root.namedChildCount() == 2);
+  CHECK(root.namedChild(0).type() == "struct_declaration"s);
+  CHECK(root.namedChild(0).start() == first);
+  CHECK(root.namedChild(1).str() == "fn f() {}");
+  CHECK(root.namedChild(1).startPoint().row == 4);
+  CHECK(root.namedChild(1).startPoint().column == 12);
+
+  // the parser includes everything again afterwards
+  CHECK_NOTHROW(cppts::Tree{parser, load_file("simple.wgsl")});
+  CHECK_THROWS_AS((cppts::Tree{parser, host}), std::invalid_argument);
+
+  std::vector<cppts::ByteRange> unordered = {ranges[1], ranges[0]};
+  CHECK_THROWS_AS((cppts::Tree{parser, host, unordered}),
+                  std::invalid_argument);
+}
+
+TEST_CASE("Parse cancellation", "[parser]") {
+  cppts::Parser local{tree_sitter_wgsl()};
+  std::string source;
+  for (int i = 0; i < 100; i++) {
+    source += load_file("simple.wgsl");
+  }
+
+  std::atomic<size_t> cancel{1};
+  local.setCancellationFlag(&cancel);
+  CHECK_THROWS_AS((cppts::Tree{local, source}), cppts::ParseAborted);
+
+  // the parser is reset and usable again
+  cancel = 0;
+  CHECK_NOTHROW(cppts::Tree{local, source});
+
+  local.setCancellationFlag(nullptr);
+  local.setTimeout(std::chrono::seconds{10});
+  CHECK(local.timeout() == std::chrono::seconds{10});
+  CHECK_NOTHROW(cppts::Tree{local, source});
+}
+
 TEST_CASE("Parsing functionality", "[parser]") {
   {
     cppts::Tree tree{parser, "var u_texture: texture_2d<f32>;"};
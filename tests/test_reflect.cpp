@@ -1,5 +1,6 @@
 #include "catch2/catch_all.hpp"
 
+#include "wgsl_reflect/layout.hpp"
 #include "wgsl_reflect/reflect.hpp"
 
 #include <tree_sitter_wgsl.h>
@@ -13,6 +14,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <stdexcept>
 
 using namespace std::string_literals;
@@ -105,18 +108,378 @@ TEST_CASE("Reflect entrypoints", "[reflect]") {
   CHECK(reflect.compute(0).name == reflect.function("other").name);
 }
 
+TEST_CASE("Reflect is movable", "[reflect]") {
+  std::vector<wgsl_reflect::Reflect> reflects;
+  reflects.emplace_back(load_file("simple.wgsl"));
+  reflects.emplace_back(load_file("reference.wgsl"));
+  reflects.emplace_back(load_file("simple.wgsl"));
+
+  const auto& reflect = reflects.front();
+  CHECK(reflect.functions().size() == 3);
+  CHECK(reflect.functions()[0].name == "vs_main");
+  CHECK(reflect.entries().vertex == std::vector<size_t>{0});
+  CHECK(reflect.vertex(0).name == "vs_main");
+  CHECK(reflect.compute(0).name == "other");
+
+  wgsl_reflect::Reflect moved{std::move(reflects.back())};
+  CHECK(moved.fragment(0).name == "fs_main");
+  CHECK(&moved.fragment(0) == &moved.function("fs_main"));
+}
+
+TEST_CASE("Reflect with parallel extraction", "[reflect]") {
+  std::string source = load_file("reference.wgsl") + load_file("simple.wgsl");
+  for (int i = 0; i < 50; i++) {
+    auto n = std::to_string(i);
+    source += "struct S" + n + " { @location(" + n + ") v" + n + ": f32, };\n" +
+              "@vertex fn f" + n + "(s: S" + n + ") {}\n";
+  }
+
+  nlohmann::json expected = wgsl_reflect::Reflect{source};
+
+  for (size_t threads : {2, 3, 8, 0}) {
+    wgsl_reflect::Reflect reflect{source, {.threads = threads}};
+    CHECK(nlohmann::json(reflect) == expected);
+    CHECK(reflect.function("f7").inputs.at(0).name == "v7");
+  }
+}
+
+TEST_CASE("Reflect cancellation", "[reflect]") {
+  std::string source = load_file("reference.wgsl");
+
+  std::atomic<size_t> cancel{1};
+  CHECK_THROWS_AS((wgsl_reflect::Reflect{source, {.cancel = &cancel}}),
+                  wgsl_reflect::ReflectAborted);
+
+  cancel = 0;
+  CHECK_NOTHROW(wgsl_reflect::Reflect{source, {.cancel = &cancel}});
+  CHECK_NOTHROW(wgsl_reflect::Reflect{
+      source, {.threads = 2, .timeout = std::chrono::seconds{10}}});
+}
+
+TEST_CASE("Reflect interface fingerprint", "[reflect]") {
+  std::string source = load_file("simple.wgsl");
+  wgsl_reflect::Reflect reflect{source};
+
+  auto edited = [&](const std::string& from, const std::string& to) {
+    std::string copy = source;
+    auto pos = copy.find(from);
+    REQUIRE(pos != std::string::npos);
+    copy.replace(pos, from.size(), to);
+    return wgsl_reflect::Reflect{copy};
+  };
+
+  SECTION("Bodies, comments and whitespace are ignored") {
+    auto other = edited("return a + b;", "// sum\n    return  b + a;");
+    CHECK(other.fingerprint() == reflect.fingerprint());
+    CHECK(other.compute(0).fingerprint == reflect.compute(0).fingerprint);
+
+    auto spaced = edited("vec3<f32>", "vec3< f32 >");
+    CHECK(spaced.fingerprint() == reflect.fingerprint());
+  }
+
+  SECTION("Interface changes are detected per entry point") {
+    // the vertex output and the fragment input
+    auto other = edited("@location(0) color", "@location(2) color");
+    CHECK(other.fingerprint() != reflect.fingerprint());
+    CHECK(other.vertex(0).fingerprint != reflect.vertex(0).fingerprint);
+    CHECK(other.fragment(0).fingerprint != reflect.fragment(0).fingerprint);
+    CHECK(other.compute(0).fingerprint == reflect.compute(0).fingerprint);
+
+    auto output = edited("-> @location(0)", "-> @location(1)");
+    CHECK(output.fragment(0).fingerprint != reflect.fragment(0).fingerprint);
+    CHECK(output.vertex(0).fingerprint == reflect.vertex(0).fingerprint);
+
+    auto renamed = edited("fn other(", "fn another(");
+    CHECK(renamed.fingerprint() != reflect.fingerprint());
+    CHECK(renamed.compute(0).fingerprint != reflect.compute(0).fingerprint);
+  }
+
+  CHECK(nlohmann::json(reflect)["fingerprint"].get<std::string>().size() ==
+        16);
+}
+
+TEST_CASE("Reflect variants", "[reflect]") {
+  std::string source = load_file("simple.wgsl");
+  wgsl_reflect::Reflect base{source};
+
+  auto edit = [&](const std::string& from, const std::string& to) {
+    auto pos = source.find(from);
+    REQUIRE(pos != std::string::npos);
+    return wgsl_reflect::SourceEdit{pos, pos + from.size(), to};
+  };
+
+  auto check = [&](const std::vector<wgsl_reflect::SourceEdit>& edits) {
+    auto variant = base.variant(edits);
+    wgsl_reflect::Reflect full{std::string{variant.source()}};
+    CHECK(nlohmann::ordered_json(variant) == nlohmann::ordered_json(full));
+    return variant;
+  };
+
+  SECTION("Function body") {
+    auto variant = check({edit("return a + b;", "return a * b;")});
+    CHECK(variant.fingerprint() == base.fingerprint());
+    // records of unchanged declarations that did not move are shared
+    CHECK(&variant.function("vs_main") == &base.function("vs_main"));
+    CHECK(&variant.function("fs_main") == &base.function("fs_main"));
+    CHECK(&variant.structure("VertexInput") == &base.structure("VertexInput"));
+    CHECK(&variant.function("other") != &base.function("other"));
+  }
+
+  SECTION("Struct used by an unchanged function") {
+    auto variant =
+        check({edit("@location(1) color: vec3<f32>,",
+                    "@location(1) color: vec3<f32>,\n    @location(2) uv: "
+                    "vec2<f32>,")});
+    CHECK(variant.vertex(0).inputs.size() == 3);
+    CHECK(base.vertex(0).inputs.size() == 2);
+  }
+
+  SECTION("Several edits, in any order") {
+    auto variant = check({edit("@fragment", "@compute @workgroup_size(1)"),
+                          edit("@vertex", "@fragment"),
+                          edit("// Fragment shader",
+                               "@group(0) @binding(1) var<uniform> u: U;")});
+    CHECK(variant.entries().vertex.empty());
+    CHECK(variant.entries().compute.size() == 2);
+    CHECK(variant.bindGroup(0)->binding(1)->name == "u");
+  }
+
+  SECTION("Overlapping edits") {
+    std::vector edits = {edit("fn other", "fn x"), edit("other", "y")};
+    CHECK_THROWS_AS(base.variant(edits), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Reflect typed attributes", "[reflect]") {
+  wgsl_reflect::Reflect reflect{R"WGSL(
+const TILE = 8u;
+const FIRST = 2;
+
+struct VertexOutput {
+    @builtin(position) position: vec4<f32>,
+    @location(FIRST + 1) @interpolate(linear, centroid) uv: vec2<f32>,
+};
+
+@compute @workgroup_size(TILE * 2, TILE / 2)
+fn cs(@builtin(global_invocation_id) id: vec3<u32>) {}
+
+@fragment
+fn fs(input: VertexOutput) -> @location(0) vec4<f32> {
+    return vec4<f32>(0.0, 0.0, 0.0, 1.0);
+}
+)WGSL"s};
+
+  const auto& cs = reflect.compute(0);
+  CHECK(cs.stage == wgsl_reflect::Stage::Compute);
+  CHECK(cs.workgroupSize == std::array<uint32_t, 3>{16, 4, 1});
+  CHECK(cs.inputs[0].builtin == wgsl_reflect::Builtin::GlobalInvocationId);
+  CHECK_FALSE(cs.inputs[0].location.has_value());
+
+  const auto& fs = reflect.fragment(0);
+  REQUIRE(fs.inputs.size() == 2);
+  CHECK(fs.inputs[0].builtin == wgsl_reflect::Builtin::Position);
+  CHECK(wgsl_reflect::builtinName(*fs.inputs[0].builtin) == "position");
+  CHECK(fs.inputs[1].location == 3u);
+  REQUIRE(fs.inputs[1].interpolation.has_value());
+  CHECK(fs.inputs[1].interpolation->type ==
+        wgsl_reflect::InterpolationType::Linear);
+  CHECK(fs.inputs[1].interpolation->sampling ==
+        wgsl_reflect::InterpolationSampling::Centroid);
+  CHECK(fs.returnType == "vec4<f32>");
+  REQUIRE(fs.outputs.size() == 1);
+  CHECK(fs.outputs[0].name.empty());
+  CHECK(fs.outputs[0].location == 0u);
+  CHECK(cs.returnType.empty());
+  CHECK(cs.outputs.empty());
+
+  nlohmann::json j = reflect;
+  CHECK(j["functions"]["cs"]["workgroupSize"] ==
+        nlohmann::json::array({16, 4, 1}));
+  CHECK(j["functions"]["fs"]["inputs"][1]["attributes"]["location"] == 3);
+
+  SECTION("Unknown constants are not evaluated") {
+    wgsl_reflect::Reflect unresolved{
+        "@compute @workgroup_size(SIZE) fn cs() {}"s};
+    CHECK_FALSE(unresolved.compute(0).workgroupSize.has_value());
+    CHECK(unresolved.compute(0).attribute("workgroup_size") == "SIZE");
+  }
+
+  SECTION("Overflowing expressions are not evaluated") {
+    for (const auto& size :
+         {"0x8000000000000000"s, "9223372036854775807 + 1"s,
+          "4611686018427387904 * 2"s, "(-9223372036854775807 - 1) % -1"s,
+          std::string(1000, '(') + "1" + std::string(1000, ')')}) {
+      wgsl_reflect::Reflect overflow{"@compute @workgroup_size(" + size +
+                                     ") fn cs() {}"};
+      CHECK_FALSE(overflow.compute(0).workgroupSize.has_value());
+    }
+
+    // the largest 32 bit value is the UNSET marker of bindings
+    for (const auto& attributes :
+         {"@group(0xFFFFFFFF) @binding(0)"s, "@group(0) @binding(4294967295)"s,
+          "@group(0) @binding(4294967296)"s}) {
+      CHECK_THROWS_AS(
+          wgsl_reflect::Reflect{attributes + " var samp: sampler;"},
+          std::domain_error);
+    }
+  }
+}
+
+TEST_CASE("Reflect evaluated binding numbers", "[reflect]") {
+  std::string source = R"WGSL(
+struct U {
+    scale: f32,
+};
+
+const G = 1;
+// a comment and an attribute in front
+@id(0) override BASE: u32 = 2u;
+
+@group(0) @binding(0x10) var<uniform> hex: U;
+@group(G) @binding(BASE * 3u) var<uniform> expression: U;
+@group(G + 1) @binding(0) var tex: texture_2d<f32>;
+)WGSL";
+  wgsl_reflect::Reflect reflect{source};
+
+  REQUIRE(reflect.binding("hex") != nullptr);
+  CHECK(reflect.binding("hex")->binding == 16);
+  REQUIRE(reflect.binding(1, 6) != nullptr);
+  CHECK(reflect.binding(1, 6)->name == "expression");
+  REQUIRE(reflect.binding(2, 0) != nullptr);
+  CHECK(reflect.binding(2, 0)->name == "tex");
+
+  wgsl_reflect::Reflect::Options options;
+  options.bindingsOnly = true;
+  wgsl_reflect::Reflect fast{source, options};
+  REQUIRE(fast.bindGroups().size() == reflect.bindGroups().size());
+  for (size_t g = 0; g < reflect.bindGroups().size(); g++) {
+    CHECK(fast.bindGroups()[g].bindings() ==
+          reflect.bindGroups()[g].bindings());
+  }
+
+  auto pos = source.find("G = 1");
+  std::vector<wgsl_reflect::SourceEdit> edits = {{pos, pos + 5, "G = 3"}};
+  auto variant = reflect.variant(edits);
+  CHECK(variant.binding(3, 6) != nullptr);
+  CHECK(variant.binding(4, 0) != nullptr);
+
+  CHECK_THROWS_AS(wgsl_reflect::Reflect{"@group(N) @binding(0) var t: "
+                                        "texture_2d<f32>;"s},
+                  std::domain_error);
+}
+
+namespace {
+/// Shader with `n` functions and bindings in between, and comments and
+/// nested braces to throw off a naive scanner
+std::string largeShader(size_t n) {
+  std::string source = "/* @group(7) @binding(7) var<uniform> no: A; */\n";
+  for (size_t i = 0; i < n; i++) {
+    auto index = std::to_string(i);
+    source += "@group(" + std::to_string(i % 4) + ") @binding(" +
+              std::to_string(i / 4) + ") var<uniform> u" + index + ": U;\n";
+    source += "// @group(8) @binding(" + index + ")\n";
+    source += "fn f" + index + "(x: f32) -> f32 {\n"
+              "    var y = x;\n"
+              "    for (var i = 0; i < 4; i++) {\n"
+              "        if (y > 1.0) { y = y * 0.5; } else { y = y + 1.0; }\n"
+              "    }\n"
+              "    /* nested /* @binding(3) */ comment */\n"
+              "    return y;\n"
+              "}\n";
+  }
+  source += "@group(0)\n@binding(999)\nvar tex: texture_2d<f32>;";
+  return source;
+}
+
+void checkSameBindGroups(const wgsl_reflect::Reflect& full,
+                         const wgsl_reflect::Reflect& fast) {
+  REQUIRE(fast.bindGroups().size() == full.bindGroups().size());
+  for (size_t g = 0; g < full.bindGroups().size(); g++) {
+    CHECK(fast.bindGroups()[g].group() == full.bindGroups()[g].group());
+    CHECK(fast.bindGroups()[g].bindings() == full.bindGroups()[g].bindings());
+  }
+}
+}  // namespace
+
+TEST_CASE("Reflect bindings only", "[reflect]") {
+  wgsl_reflect::Reflect::Options options;
+  options.bindingsOnly = true;
+
+  for (const auto& name : {"simple.wgsl", "reference.wgsl"}) {
+    auto source = load_file(name);
+    wgsl_reflect::Reflect fast{source, options};
+    checkSameBindGroups(wgsl_reflect::Reflect{source}, fast);
+    CHECK(fast.functions().empty());
+  }
+
+  auto source = largeShader(100);
+  wgsl_reflect::Reflect full{source};
+  wgsl_reflect::Reflect fast{source, options};
+  checkSameBindGroups(full, fast);
+  CHECK(fast.bindGroup(0)->binding(999)->name == "tex");
+  CHECK(fast.bindGroups().size() == 4);
+
+  // sources of different lengths end in different parts of a SIMD block
+  for (size_t n = 0; n < 8; n++) {
+    auto small = largeShader(n);
+    checkSameBindGroups(wgsl_reflect::Reflect{small},
+                        wgsl_reflect::Reflect{small, options});
+  }
+}
+
+TEST_CASE("Reflect bindings only speedup", "[.][benchmark]") {
+  auto source = largeShader(2000);
+  wgsl_reflect::Reflect::Options options;
+  options.bindingsOnly = true;
+
+  BENCHMARK("Full reflection") { return wgsl_reflect::Reflect{source}; };
+  BENCHMARK("Bindings only") {
+    return wgsl_reflect::Reflect{source, options};
+  };
+}
+
+TEST_CASE("Reflect detach", "[reflect]") {
+  std::string source = load_file("reference.wgsl");
+  wgsl_reflect::Reflect reflect{source};
+  nlohmann::json before = reflect;
+
+  auto attached = reflect.memoryUsage();
+  CHECK(attached.source >= source.size());
+  CHECK(attached.tree > source.size());
+  CHECK(attached.parser);
+  CHECK(attached.model > 0);
+
+  reflect.detach();
+  auto detached = reflect.memoryUsage();
+  CHECK(detached.source == 0);
+  CHECK(detached.tree == 0);
+  CHECK_FALSE(detached.parser);
+  CHECK(detached.model == attached.model);
+  CHECK(detached.total() < attached.total());
+
+  CHECK(reflect.source().empty());
+  CHECK(nlohmann::json(reflect) == before);
+  CHECK(reflect.vertex(0).name == "main");
+  CHECK_THROWS_AS(reflect.variant({}), std::logic_error);
+
+  wgsl_reflect::Reflect automatic{source, {.detach = true}};
+  CHECK(automatic.memoryUsage().total() == detached.total());
+  CHECK(automatic.fingerprint() == reflect.fingerprint());
+}
+
 TEST_CASE("Reflect bind groups", "[reflect]") {
   wgsl_reflect::Reflect reflect{load_file("reference.wgsl")};
 
-  CHECK(reflect.bindGroups().size() == 3);
-  CHECK(reflect.bindGroup(0)->size() == 5);
+  REQUIRE(reflect.bindGroups().size() == 2);
+  CHECK(reflect.bindGroup(0)->size() == 4);
 
   {
-    auto g = reflect.bindGroup(0).value();
+    const auto& g = *reflect.bindGroup(0);
+    CHECK(g.group() == 0);
 
     {
-      auto b = g.binding(0).value();
-      CHECK(b == g[0].value());
+      auto b = *g.binding(0);
+      CHECK(b == *g[0]);
       CHECK(b.name == "viewUniforms");
       CHECK(b.type == "ViewUniforms");
       CHECK(b.bindingType == "buffer");
@@ -124,8 +487,8 @@ TEST_CASE("Reflect bind groups", "[reflect]") {
     }
 
     {
-      auto b = g[1].value();
-      CHECK(b == g.binding(1));
+      auto b = *g[1];
+      CHECK(b == *g.binding(1));
       CHECK(b.name == "modelUniforms");
       CHECK(b.type == "ModelUniforms");
       CHECK(b.bindingType == "buffer");
@@ -133,48 +496,44 @@ TEST_CASE("Reflect bind groups", "[reflect]") {
     }
 
     {
-      auto b = g[2].value();
-      CHECK(b == g.binding(2));
+      auto b = *g[2];
+      CHECK(b == *g.binding(2));
       CHECK(b.name == "u_sampler");
       CHECK(b.type == "sampler");
       CHECK(b.bindingType == b.type);
       CHECK(b.group == 0);
     }
 
-    CHECK_FALSE(g[3].has_value());
+    CHECK(g[3] == nullptr);
 
     {
-      auto b = g[4].value();
-      CHECK(b == g.binding(4));
+      auto b = *g[4];
+      CHECK(b == *g.binding(4));
       CHECK(b.name == "u_texture");
       CHECK(b.type == "texture_2d");
       CHECK(b.bindingType == b.type);
       CHECK(b.group == 0);
     }
 
-    std::vector<size_t> notHasValue;
-    for (size_t i = 0; i < g.size(); i++) {
-      if (g[i].has_value()) {
-        CHECK(g[i]->binding == i);
-      } else {
-        notHasValue.push_back(i);
-      }
+    std::vector<uint32_t> numbers;
+    for (const auto& b : g.bindings()) {
+      numbers.push_back(b.binding);
     }
-    CHECK(notHasValue == std::vector<size_t>({3}));
+    CHECK(numbers == std::vector<uint32_t>({0, 1, 2, 4}));
 
-    CHECK_THROWS(g.binding(5));
+    CHECK(g.binding(5) == nullptr);
   }
 
-  CHECK_FALSE(reflect.bindGroup(1).has_value());
+  CHECK(reflect.bindGroup(1) == nullptr);
 
   CHECK(reflect.bindGroup(2)->size() == 1);
 
   {
-    auto g = reflect.bindGroup(2).value();
+    const auto& g = *reflect.bindGroup(2);
 
-    auto b = g[0].value();
+    auto b = *g[0];
 
-    CHECK_THROWS(g[1]);
+    CHECK(g[1] == nullptr);
 
     CHECK(b.name == "storage_buffer");
     CHECK(b.type == "B");
@@ -183,5 +542,71 @@ TEST_CASE("Reflect bind groups", "[reflect]") {
     CHECK(b.binding == 0);
   }
 
-  CHECK_THROWS(reflect.bindGroup(3));
+  CHECK(reflect.bindGroup(3) == nullptr);
+
+  CHECK(reflect.binding(0, 4)->name == "u_texture");
+  CHECK(reflect.binding(2, 1) == nullptr);
+  CHECK(reflect.binding(7, 0) == nullptr);
+  CHECK(reflect.binding("storage_buffer") == reflect.binding(2, 0));
+  CHECK(reflect.binding("nope") == nullptr);
+}
+
+TEST_CASE("Reflect sparse bindings", "[reflect]") {
+  wgsl_reflect::Reflect reflect{R"WGSL(
+    @group(3) @binding(60000) var tex: texture_2d<f32>;
+    @group(3) @binding(7) var samp: sampler;
+    @group(1000) @binding(70000) var other: sampler;
+  )WGSL"s};
+
+  REQUIRE(reflect.bindGroups().size() == 2);
+  CHECK(reflect.bindGroups()[0].group() == 3);
+  CHECK(reflect.bindGroups()[1].group() == 1000);
+
+  const auto& g = reflect.bindGroups()[0];
+  CHECK(g.size() == 2);
+  CHECK(g.bindings()[0].name == "samp");
+  CHECK(g.bindings()[1].name == "tex");
+  CHECK(g.binding(60000)->name == "tex");
+  CHECK(g.binding(59999) == nullptr);
+  CHECK(reflect.binding(1000, 70000)->name == "other");
+  CHECK(reflect.binding("tex") == g.binding(60000));
+
+  nlohmann::json j = reflect;
+  REQUIRE(j["bindgroups"].size() == 2);
+  CHECK(j["bindgroups"][0]["group"] == 3);
+  CHECK(j["bindgroups"][0]["bindings"].size() == 2);
+  CHECK(j["bindgroups"][1]["bindings"][0]["name"] == "other");
+}
+
+TEST_CASE("Reflect sparse groups", "[reflect]") {
+  wgsl_reflect::Reflect reflect{R"WGSL(
+    @group(1000) @binding(0) var samp: sampler;
+    @group(4000000000) @binding(1) var tex: texture_2d<f32>;
+    @fragment fn fs() {}
+  )WGSL"s};
+
+  auto layouts = wgsl_reflect::bindGroupLayouts(reflect);
+  REQUIRE(layouts.size() == 2);
+  CHECK(layouts[0].group == 1000);
+  CHECK(layouts[1].group == 4000000000u);
+  CHECK(wgsl_reflect::findLayout(layouts, 999) == nullptr);
+  CHECK(wgsl_reflect::findLayout(layouts, 4000000000u)->entry(1)->resource ==
+        "texture_2d");
+
+  std::vector all = {layouts, layouts};
+  auto merged = wgsl_reflect::mergeLayouts(all);
+  CHECK(merged.ok());
+  REQUIRE(merged.groups.size() == 2);
+  CHECK(merged.group(1000)->entry(0)->resource == "sampler");
+}
+
+TEST_CASE("Reflect ignores globals without bindings", "[reflect]") {
+  wgsl_reflect::Reflect reflect{R"WGSL(
+    var<private> counter: i32;
+    @group(1) @binding(2) var u_sampler: sampler;
+  )WGSL"s};
+
+  CHECK(reflect.bindGroups().size() == 1);
+  CHECK(reflect.bindGroup(0) == nullptr);
+  CHECK(reflect.bindGroup(1)->binding(2)->name == "u_sampler");
 }
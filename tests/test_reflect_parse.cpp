@@ -1,5 +1,6 @@
 #include "catch2/catch_all.hpp"
 
+#include "wgsl_reflect/ast.hpp"
 #include "wgsl_reflect/reflect.hpp"
 
 #include <tree_sitter_wgsl.h>
@@ -67,6 +68,8 @@ TEST_CASE("Parse function", "[reflect]") {
     CHECK(function.attribute("compute").value() == ""s);
     CHECK_FALSE(function.attribute("vertex").has_value());
     CHECK(function.attribute("workgroup_size").value() == "8,4,1"s);
+    CHECK(function.stage == wgsl_reflect::Stage::Compute);
+    CHECK(function.workgroupSize == std::array<uint32_t, 3>{8, 4, 1});
   }
 
   SECTION("Flat inputs with locations") {
@@ -98,6 +101,15 @@ TEST_CASE("Parse function", "[reflect]") {
     CHECK(in2.attributes[0].value == "2");
     CHECK(in2.attributes[1].name == "interpolate");
     CHECK(in2.attributes[1].value == "flat");
+
+    CHECK(in1.location == 0u);
+    CHECK_FALSE(in1.interpolation.has_value());
+    CHECK(in2.location == 2u);
+    REQUIRE(in2.interpolation.has_value());
+    CHECK(in2.interpolation->type == wgsl_reflect::InterpolationType::Flat);
+    CHECK_FALSE(in2.interpolation->sampling.has_value());
+    CHECK(function.stage == wgsl_reflect::Stage::Fragment);
+    CHECK_FALSE(function.workgroupSize.has_value());
   }
 
   SECTION("Structure parameter not resolved") {
@@ -366,5 +378,78 @@ TEST_CASE("Parse bind groups", "[reflect]") {
     CHECK(binding.name == "u_texture");
     CHECK(binding.bindingType == "texture_2d");
     CHECK(binding.type == "texture_2d");
+    CHECK(binding.sampleType == "f32");
+  }
+
+  SECTION("Texture details") {
+    cppts::Tree tree{parser, R"WGSL(
+@group(0) @binding(0) var a: texture_2d_array<u32>;
+@group(0) @binding(1) var b: texture_multisampled_2d<i32>;
+@group(0) @binding(2) var c: texture_depth_cube_array;
+@group(0) @binding(3) var d: texture_storage_2d<rgba8unorm, read_write>;
+)WGSL"};
+    auto root = tree.rootNode();
+
+    wgsl_reflect::Binding a{root.namedChild(0)};
+    CHECK(a.sampleType == "u32");
+    CHECK(a.viewDimension == "2d_array");
+    CHECK_FALSE(a.multisampled);
+
+    wgsl_reflect::Binding b{root.namedChild(1)};
+    CHECK(b.sampleType == "i32");
+    CHECK(b.viewDimension == "2d");
+    CHECK(b.multisampled);
+
+    wgsl_reflect::Binding c{root.namedChild(2)};
+    CHECK(c.sampleType.empty());
+    CHECK(c.viewDimension == "cube_array");
+
+    wgsl_reflect::Binding d{root.namedChild(3)};
+    CHECK(d.bindingType == "texture_storage_2d");
+    CHECK(d.texelFormat == "rgba8unorm");
+    CHECK(d.accessMode == "read_write");
+    CHECK(d.viewDimension == "2d");
+  }
+}
+
+TEST_CASE("Typed AST", "[ast]") {
+  cppts::Parser parser{tree_sitter_wgsl()};
+  std::string source = R"WGSL(
+      struct VertexInput {
+        @location(0) position: vec3<f32>,
+        @location(1) color: vec3<f32>,
+      };
+
+      @vertex
+      fn main(input: VertexInput) -> VertexOutput {
+          return a + b;
+      }
+    )WGSL";
+  cppts::Tree tree{parser, source};
+
+  auto snode = tree.rootNode().namedChild(0);
+  auto fnode = tree.rootNode().namedChild(1);
+
+  CHECK(wgsl_reflect::ast::StructDeclaration::cast(snode).has_value());
+  CHECK_FALSE(wgsl_reflect::ast::StructDeclaration::cast(fnode).has_value());
+
+  wgsl_reflect::ast::StructDeclaration _struct{snode};
+  CHECK(_struct.name().str() == "VertexInput");
+  std::vector<std::string> members;
+  for (auto member : _struct.structMembers()) {
+    members.emplace_back(member.variableIdentifierDeclaration()->name().str());
   }
-}
\ No newline at end of file
+  CHECK(members == std::vector<std::string>{"position", "color"});
+
+  wgsl_reflect::ast::FunctionDeclaration function{fnode};
+  CHECK(function.name().str() == "main");
+  CHECK(function.attribute().has_value());
+  CHECK(function.parameterList().has_value());
+  size_t n = 0;
+  for (auto param : function.parameterList()->parameters()) {
+    CHECK(param.variableIdentifierDeclaration()->type().str() ==
+          "VertexInput");
+    n++;
+  }
+  CHECK(n == 1);
+}
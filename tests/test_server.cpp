@@ -0,0 +1,136 @@
+#include "catch2/catch_all.hpp"
+
+#include "wgsl_reflect/server.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include "util.hpp"
+
+#include <sstream>
+
+using namespace std::string_literals;
+using nlohmann::json;
+
+namespace {
+json call(wgsl_reflect::Server& server, const std::string& method,
+          json params) {
+  json request = {
+      {"jsonrpc", "2.0"}, {"id", 1}, {"method", method}, {"params", params}};
+  auto response = server.handle(request.dump());
+  REQUIRE(response.has_value());
+  return json::parse(*response);
+}
+}  // namespace
+
+TEST_CASE("Server documents", "[server]") {
+  wgsl_reflect::Server server;
+  std::string source = load_file("reference.wgsl");
+
+  CHECK(call(server, "open", {{"uri", "a.wgsl"}, {"text", source}})
+            .contains("result"));
+  CHECK(server.documentCount() == 1);
+
+  auto reflect = call(server, "reflect", {{"uri", "a.wgsl"}});
+  CHECK(reflect["id"] == 1);
+  CHECK(reflect["result"] == json(wgsl_reflect::Reflect{source}));
+
+  auto layout = call(server, "layout", {{"uri", "a.wgsl"}});
+  REQUIRE(layout["result"].size() == 2);
+  CHECK(layout["result"][0]["group"] == 0);
+  CHECK(layout["result"][0]["entries"][0]["resource"] == "uniform");
+  CHECK(layout["result"][1]["group"] == 2);
+
+  auto bindings = call(server, "bindings", {{"uri", "a.wgsl"}});
+  REQUIRE(bindings["result"].is_array());
+  CHECK(bindings["result"][0]["name"] == "viewUniforms");
+
+  auto entries = call(server, "entryPoints", {{"uri", "a.wgsl"}});
+  CHECK(entries["result"] == reflect["result"]["entries"]);
+
+  auto vertexBuffers = call(server, "vertexBuffers", {{"uri", "a.wgsl"}});
+  auto main = reflect["result"]["functions"]["main"];
+  CHECK(vertexBuffers["result"]["main"] == main["vertexBuffers"]);
+  CHECK(vertexBuffers["result"]["main"][0]["arrayStride"] == 48);
+
+  SECTION("Incremental edits") {
+    auto pos = source.find("viewUniforms");
+    json edit = {{"start", pos},
+                 {"end", pos + "viewUniforms"s.size()},
+                 {"text", "cameraUniforms"}};
+    call(server, "change", {{"uri", "a.wgsl"}, {"edits", {edit}}});
+    bindings = call(server, "bindings", {{"uri", "a.wgsl"}});
+    CHECK(bindings["result"][0]["name"] == "cameraUniforms");
+
+    // each edit refers to the text after the previous ones
+    source.replace(pos, "viewUniforms"s.size(), "cameraUniforms");
+    json edits = {{{"start", pos}, {"end", pos + 6}, {"text", "eye"}},
+                  {{"start", 0}, {"end", 0}, {"text", "// header\n"}},
+                  {{"start", pos + 13}, {"end", pos + 13}, {"text", "Main"}},
+                  {{"start", source.size() + 11}, {"end", source.size() + 11},
+                   {"text", "\nfn f() {}"}}};
+    call(server, "change", {{"uri", "a.wgsl"}, {"edits", edits}});
+    source.replace(pos, 6, "eye");
+    source.insert(0, "// header\n");
+    source.insert(pos + 13, "Main");
+    source += "\nfn f() {}";
+    bindings = call(server, "bindings", {{"uri", "a.wgsl"}});
+    CHECK(bindings["result"][0]["name"] == "eyeMainUniforms");
+    CHECK(call(server, "reflect", {{"uri", "a.wgsl"}})["result"] ==
+          json(wgsl_reflect::Reflect{source}));
+  }
+
+  SECTION("Close") {
+    call(server, "close", {{"uri", "a.wgsl"}});
+    CHECK(server.documentCount() == 0);
+    auto response = call(server, "reflect", {{"uri", "a.wgsl"}});
+    CHECK(response["error"]["code"] == -32602);
+  }
+}
+
+TEST_CASE("Server errors", "[server]") {
+  wgsl_reflect::Server server;
+
+  auto parse = json::parse(server.handle("{nope").value());
+  CHECK(parse["error"]["code"] == -32700);
+
+  auto unknown = call(server, "blubb", json::object());
+  CHECK(unknown["error"]["code"] == -32601);
+
+  call(server, "open", {{"uri", "bad.wgsl"}, {"text", "fn {"}});
+  auto invalid = call(server, "reflect", {{"uri", "bad.wgsl"}});
+  CHECK(invalid["error"]["code"] == -32000);
+
+  // sparse group numbers do not allocate a layout per group
+  call(server, "open",
+       {{"uri", "huge.wgsl"},
+        {"text", "@group(4000000000) @binding(0) var samp: sampler;"}});
+  auto huge = call(server, "layout", {{"uri", "huge.wgsl"}});
+  REQUIRE(huge["result"].size() == 1);
+  CHECK(huge["result"][0]["group"] == 4000000000u);
+  CHECK(call(server, "bindings", {{"uri", "huge.wgsl"}})["result"].size() ==
+        1);
+
+  // notifications are not answered
+  CHECK_FALSE(server
+                  .handle(R"({"jsonrpc":"2.0","method":"open",)"
+                          R"("params":{"uri":"b.wgsl","text":""}})")
+                  .has_value());
+  CHECK(server.documentCount() == 3);
+}
+
+TEST_CASE("Server loop", "[server]") {
+  wgsl_reflect::Server server;
+  std::stringstream in;
+  in << R"({"jsonrpc":"2.0","id":"x","method":"open",)"
+     << R"("params":{"uri":"s","text":"struct A { a: f32, };"}})" << "\n\n"
+     << R"({"jsonrpc":"2.0","id":2,"method":"entryPoints",)"
+     << R"("params":{"uri":"s"}})" << "\n";
+  std::stringstream out;
+  server.run(in, out);
+
+  std::string line;
+  std::getline(out, line);
+  CHECK(json::parse(line)["id"] == "x");
+  std::getline(out, line);
+  CHECK(json::parse(line)["result"]["vertex"] == json::array());
+}
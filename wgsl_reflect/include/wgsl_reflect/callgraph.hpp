@@ -0,0 +1,83 @@
+#pragma once
+
+#include "wgsl_reflect/reflect.hpp"
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wgsl_reflect {
+
+enum class DeclarationKind {
+  Function,
+  Structure,
+  /// Module scope `var`s, including resource bindings
+  Variable,
+  /// `enable`, `requires` and `diagnostic` directives
+  Directive,
+  /// Constants, overrides and type aliases
+  Other,
+};
+
+/// Top level declaration of a module
+struct Declaration {
+  DeclarationKind kind;
+  std::string name;
+  /// Byte range of the declaration, attributes included, in
+  /// Reflect::source()
+  size_t start;
+  size_t end;
+  /// Declarations named in this one, as indices into
+  /// CallGraph::declarations(), in order of first mention
+  std::vector<size_t> references;
+};
+
+/// References between the top level declarations of a module: the calls of
+/// its functions, and the structures, constants and globals every
+/// declaration names. Reachability is computed once per declaration, reusing
+/// the results of the declarations it refers to.
+///
+/// References are found by name. A local shadowing a top level declaration
+/// counts as a reference to it, so reachable sets may be larger than
+/// necessary, but never miss anything.
+class CallGraph {
+ public:
+  /// `reflect` has to outlive the graph. Throws std::logic_error for
+  /// composed reflections, which have no source of their own.
+  explicit CallGraph(const Reflect& reflect);
+
+  /// Declarations in source order
+  const std::vector<Declaration>& declarations() const {
+    return m_declarations;
+  }
+
+  /// Declaration named `name`. Throws std::out_of_range for unknown names.
+  const Declaration& declaration(const std::string& name) const;
+
+  /// Names of the functions `function` calls directly
+  std::vector<std::string> calls(const std::string& function) const;
+
+  /// Declarations reachable from `name`, itself included, as indices into
+  /// declarations() in source order
+  const std::vector<size_t>& reachable(const std::string& name) const;
+
+  /// Bind groups holding only the bindings reachable from `entry`, sorted by
+  /// group like Reflect::bindGroups()
+  std::vector<BindGroup> bindGroups(const std::string& entry) const;
+
+  /// WGSL source of the module without the declarations `entry` does not
+  /// reach. The remaining declarations and all directives are copied from
+  /// the original source in source order.
+  std::string strip(const std::string& entry) const;
+
+ private:
+  size_t index(const std::string& name) const;
+
+  const Reflect* m_reflect;
+  std::vector<Declaration> m_declarations;
+  std::unordered_map<std::string, size_t> m_index;
+  std::vector<std::vector<size_t>> m_reachable;
+};
+
+}  // namespace wgsl_reflect
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "wgsl_reflect/reflect.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace wgsl_reflect {
+
+/// Languages of files WGSL is embedded in
+enum class HostLanguage {
+  Cpp,
+  JavaScript,
+  Markdown,
+};
+
+/// Host language of a file by its extension, e.g. .cpp, .ts or .md
+std::optional<HostLanguage> hostLanguage(const std::filesystem::path& path);
+
+/// Ranges of WGSL embedded in `source`, to be reflected in place with
+/// Reflect's host constructor:
+///
+/// - C++ raw string literals delimited by wgsl in any case, R"wgsl(...)wgsl"
+/// - JavaScript and TypeScript template literals tagged wgsl`...` or
+///   preceded by a /* wgsl */ comment. Literals with ${} substitutions are
+///   skipped, their text is only known at run time.
+/// - Markdown code blocks fenced with ```wgsl or ~~~wgsl
+std::vector<SourceRange> findEmbeddedWgsl(std::string_view source,
+                                          HostLanguage language);
+
+/// Location of the byte `offset` of `source`
+SourceLocation locate(std::string_view source, size_t offset);
+
+}  // namespace wgsl_reflect
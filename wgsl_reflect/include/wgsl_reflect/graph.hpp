@@ -0,0 +1,66 @@
+#pragma once
+
+#include "wgsl_reflect/reflect.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wgsl_reflect {
+
+/// Set of WGSL source units, e.g. shaders and the shared snippets they
+/// import. Every distinct source is parsed and reflected once, no matter how
+/// many units contain it or how often it is imported, and shaders are
+/// composed from the cached results of their imports.
+class ModuleGraph {
+ public:
+  explicit ModuleGraph(const Reflect::Options& options = {});
+
+  /// Add or replace the unit `name`. `imports` name other units whose
+  /// declarations are visible to this one.
+  void add(const std::string& name, const std::string& source,
+           std::vector<std::string> imports = {});
+
+  void remove(const std::string& name);
+
+  bool contains(const std::string& name) const {
+    return m_units.count(name) > 0;
+  }
+
+  /// Reflection of the unit on its own
+  const Reflect& unit(const std::string& name) const;
+
+  /// Reflection of the unit composed with its transitive imports, imports
+  /// first. Struct inputs resolve across units. It is cached until the graph
+  /// changes and stays valid as long as it is held. Throws
+  /// std::invalid_argument for unknown units.
+  std::shared_ptr<const Reflect> compose(const std::string& name);
+
+  /// Number of distinct sources that were parsed and are still in use
+  size_t cachedSources() const { return m_cache.size(); }
+
+ private:
+  struct Unit {
+    std::shared_ptr<const Reflect> reflect;
+    std::vector<std::string> imports;
+  };
+
+  struct CacheEntry {
+    std::shared_ptr<const Reflect> reflect;
+    /// Copy of the source of detached reflections, which keep none, so
+    /// that a hash collision cannot return another source's reflection
+    std::string source;
+  };
+
+  void evictUnused();
+
+  Reflect::Options m_options;
+  std::unordered_map<std::string, Unit> m_units;
+  /// Reflected sources by content hash
+  std::unordered_multimap<uint64_t, CacheEntry> m_cache;
+  /// Composed units, dropped whenever the graph changes
+  std::unordered_map<std::string, std::shared_ptr<const Reflect>> m_composed;
+};
+
+}  // namespace wgsl_reflect
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "wgsl_reflect/reflect.hpp"
+#include "wgsl_reflect/vertex.hpp"
+
+#include <nlohmann/json_fwd.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace wgsl_reflect {
+
+/// Shader stage bits, as in WebGPU's GPUShaderStage
+struct ShaderStage {
+  static constexpr uint32_t Vertex = 0x1;
+  static constexpr uint32_t Fragment = 0x2;
+  static constexpr uint32_t Compute = 0x4;
+};
+
+struct BindGroupLayoutEntry {
+  uint32_t binding;
+  /// "uniform", "storage" or "read-only-storage" for buffers, otherwise the
+  /// binding type, e.g. "sampler" or "texture_2d"
+  std::string resource;
+  /// ShaderStage bits
+  uint32_t visibility{0};
+
+  /// Texture details, named as in WebGPU's GPUTextureBindingLayout and
+  /// GPUStorageTextureBindingLayout, empty for other resources.
+  /// "float", "sint", "uint" or "depth"
+  std::string sampleType;
+  /// e.g. "2d" or "cube-array"
+  std::string viewDimension;
+  bool multisampled{false};
+  /// Texel format of storage textures, e.g. "rgba8unorm"
+  std::string format;
+  /// "write-only", "read-only" or "read-write" for storage textures
+  std::string access;
+
+  /// Whether both entries bind the same resource, regardless of visibility
+  bool sameResource(const BindGroupLayoutEntry& other) const;
+
+  bool operator==(const BindGroupLayoutEntry& other) const = default;
+};
+
+/// Canonical, name independent layout of one bind group. Entries are sorted
+/// by binding number, so structurally identical groups of different shaders
+/// compare and hash equal.
+class BindGroupLayout {
+ public:
+  BindGroupLayout() = default;
+  BindGroupLayout(const BindGroup& group, uint32_t visibility);
+  explicit BindGroupLayout(std::vector<BindGroupLayoutEntry> entries);
+
+  const std::vector<BindGroupLayoutEntry>& entries() const {
+    return m_entries;
+  }
+
+  /// Entry for `binding`, or nullptr
+  const BindGroupLayoutEntry* entry(uint32_t binding) const;
+
+  uint64_t hash() const { return m_hash; }
+
+  bool operator==(const BindGroupLayout& other) const {
+    return m_hash == other.m_hash && m_entries == other.m_entries;
+  }
+
+ private:
+  void canonicalize();
+
+  std::vector<BindGroupLayoutEntry> m_entries;
+  uint64_t m_hash{0};
+};
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const BindGroupLayout& layout);
+
+/// Layout of one group of a pipeline. Lists of them are sorted by group
+/// number and hold only groups with bindings, so that sparse group numbers
+/// cost no memory.
+struct GroupLayout {
+  uint32_t group;
+  BindGroupLayout layout;
+
+  bool operator==(const GroupLayout& other) const = default;
+};
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const GroupLayout& layout);
+
+/// Layout of `group` in `layouts`, or nullptr if it has none
+const BindGroupLayout* findLayout(std::span<const GroupLayout> layouts,
+                                  uint32_t group);
+
+/// Layouts of `groups`, e.g. the groups CallGraph::bindGroups() gives for
+/// one entry point, visible to `visibility`
+std::vector<GroupLayout> bindGroupLayouts(std::span<const BindGroup> groups,
+                                          uint32_t visibility);
+
+/// Bind group layouts of a module, visible to `visibility`
+std::vector<GroupLayout> bindGroupLayouts(const Reflect& reflect,
+                                          uint32_t visibility);
+
+/// Bind group layouts of a module, visible to the stages it has entry points
+/// for
+std::vector<GroupLayout> bindGroupLayouts(const Reflect& reflect);
+
+struct LayoutConflict {
+  uint32_t group;
+  uint32_t binding;
+  /// The conflicting resources with their texture details, e.g.
+  /// "texture_2d<float>"
+  std::string first;
+  std::string second;
+};
+
+/// Bind group layouts combined from several modules or entry points
+struct PipelineLayout {
+  /// Sorted by group number
+  std::vector<GroupLayout> groups;
+  /// Bindings declared with different resources. The first declaration is
+  /// kept in `groups`.
+  std::vector<LayoutConflict> conflicts;
+
+  bool ok() const { return conflicts.empty(); }
+
+  /// Layout of `group`, or nullptr if it has none
+  const BindGroupLayout* group(uint32_t group) const {
+    return findLayout(groups, group);
+  }
+};
+
+/// Merge bind group layouts, e.g. of a vertex and a fragment shader. Entries
+/// with the same group and binding are combined and their visibility is
+/// joined.
+PipelineLayout mergeLayouts(std::span<const std::vector<GroupLayout>> layouts);
+
+/// Vertex buffer layouts of a vertex entry point, indexed by buffer slot.
+/// `locationToBuffer` assigns locations to buffers, unlisted locations go to
+/// buffer 0. Builtin inputs are skipped.
+std::vector<VertexBufferLayout> vertexBufferLayouts(
+    const Function& entry,
+    const std::unordered_map<uint32_t, uint32_t>& locationToBuffer = {});
+
+}  // namespace wgsl_reflect
+
+template <>
+struct std::hash<wgsl_reflect::BindGroupLayout> {
+  size_t operator()(const wgsl_reflect::BindGroupLayout& layout) const {
+    return static_cast<size_t>(layout.hash());
+  }
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "wgsl_reflect/reflect.hpp"
+
+#include <nlohmann/json_fwd.hpp>
+
+#include <map>
+#include <string>
+
+namespace wgsl_reflect {
+
+struct MinifyOptions {
+  /// Rename entry points, which pipelines refer to by name
+  bool renameEntryPoints{false};
+  /// Rename resource bindings. Their numbers are kept.
+  bool renameBindings{false};
+  /// Rename the @location and @builtin parameters of entry points
+  bool renameInputs{false};
+};
+
+struct Minified {
+  std::string source;
+
+  /// Original and new names of entry points and bindings renamed on request
+  std::map<std::string, std::string> entryPoints;
+  std::map<std::string, std::string> bindings;
+  /// Renamed entry point parameters, by entry point
+  std::map<std::string, std::map<std::string, std::string>> inputs;
+};
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const Minified& minified);
+
+/// Compact WGSL from the parse tree of a reflected module. Comments and
+/// whitespace are dropped, and the parameters and locals of functions,
+/// helper functions and structures get short names. Struct members,
+/// constants, overrides and module scope variables keep theirs. Names that
+/// could refer to more than one declaration are left alone.
+class Minifier {
+ public:
+  explicit Minifier(const MinifyOptions& options = {}) : m_options{options} {}
+
+  /// Throws std::logic_error for composed reflections, which have no source
+  /// of their own
+  Minified minify(const Reflect& reflect) const;
+
+ private:
+  MinifyOptions m_options;
+};
+
+}  // namespace wgsl_reflect
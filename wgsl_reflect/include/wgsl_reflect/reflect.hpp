@@ -1,50 +1,154 @@
 #pragma once
 
+#include "wgsl_reflect/vertex.hpp"
+
 #include <nlohmann/json_fwd.hpp>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <ranges>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace cppts {
 class Parser;
 class Tree;
 class Node;
+struct ByteRange;
 }  // namespace cppts
 
 namespace wgsl_reflect {
 
+// The to_json overloads are instantiated for nlohmann::json, which sorts
+// object keys, and nlohmann::ordered_json, which keeps declarations in
+// source order. Both give identical output for identical input on every
+// platform.
+
 class Reflect;
+class ModuleGraph;
+class CallGraph;
+class Minifier;
+
+namespace detail {
+struct SharedParser;
+
+/// Shared records as a view of references
+template <typename T>
+auto records(const std::vector<std::shared_ptr<const T>>& items) {
+  return items | std::views::transform(
+                     [](const auto& item) -> const T& { return *item; });
+}
+}  // namespace detail
+
+/// Byte range [start, end) of a source
+struct SourceRange {
+  size_t start;
+  size_t end;
+};
+
+/// Position of a declaration in the source it was reflected from, with zero
+/// based line and column. Columns count bytes.
+struct SourceLocation {
+  size_t offset{0};
+  uint32_t line{0};
+  uint32_t column{0};
+
+  bool operator==(const SourceLocation& other) const = default;
+};
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const SourceLocation& location);
 
 struct InputAttribute {
   std::string name;
   std::string value;
 };
 
-void to_json(nlohmann::json& j, const InputAttribute& attribute);
-void to_json(nlohmann::json& j, const std::vector<InputAttribute>& attributes);
+template <typename BasicJson>
+void to_json(BasicJson& j, const InputAttribute& attribute);
+template <typename BasicJson>
+void to_json(BasicJson& j, const std::vector<InputAttribute>& attributes);
+
+/// Values of @builtin
+enum class Builtin : uint8_t {
+  VertexIndex,
+  InstanceIndex,
+  Position,
+  FrontFacing,
+  FragDepth,
+  SampleIndex,
+  SampleMask,
+  LocalInvocationId,
+  LocalInvocationIndex,
+  GlobalInvocationId,
+  WorkgroupId,
+  NumWorkgroups,
+  SubgroupInvocationId,
+  SubgroupSize,
+};
+
+/// WGSL name of a builtin, e.g. "vertex_index"
+std::string_view builtinName(Builtin builtin);
+
+enum class InterpolationType : uint8_t { Perspective, Linear, Flat };
+
+enum class InterpolationSampling : uint8_t {
+  Center,
+  Centroid,
+  Sample,
+  First,
+  Either,
+};
+
+struct Interpolation {
+  InterpolationType type;
+  /// Unset means the default, center, or first for flat interpolation
+  std::optional<InterpolationSampling> sampling;
+};
+
+enum class Stage : uint8_t { Vertex, Fragment, Compute };
 
 struct Input {
   std::string name;
   std::string type;
+  /// Attributes as written, with the first argument as value. The typed
+  /// values below are evaluated from them again for the constants of
+  /// variants and compositions.
   std::vector<InputAttribute> attributes;
+
+  /// Typed attribute values. A location is only set if its expression could
+  /// be evaluated, see Reflect for constants.
+  std::optional<uint32_t> location;
+  std::optional<Builtin> builtin;
+  std::optional<Interpolation> interpolation;
 };
 
-void to_json(nlohmann::json& j, const Input& input);
-void to_json(nlohmann::json& j, const std::vector<Input>& inputs);
+template <typename BasicJson>
+void to_json(BasicJson& j, const Input& input);
+template <typename BasicJson>
+void to_json(BasicJson& j, const std::vector<Input>& inputs);
 
 struct Structure {
   explicit Structure(cppts::Node node);
 
   std::string name;
   std::vector<Input> members;
+  SourceLocation location;
 };
 
-void to_json(nlohmann::json& j, const Structure& structure);
+template <typename BasicJson>
+void to_json(BasicJson& j, const Structure& structure);
 
 struct Function {
   explicit Function(cppts::Node node,
@@ -56,13 +160,43 @@ struct Function {
 
   std::string name;
   std::vector<Input> inputs;
-  std::unordered_map<std::string, std::string> attributes;
+  /// Attributes in source order, with an empty value for flags like @vertex
+  std::vector<InputAttribute> attributes;
+
+  /// Return type, empty if there is none
+  std::string returnType;
+  /// Members of a struct return type, like struct inputs, or else the return
+  /// type with its attributes, e.g. @location(0), and an empty name
+  std::vector<Input> outputs;
+
+  SourceLocation location;
+
+  /// Stage of entry points
+  std::optional<Stage> stage;
+  /// @workgroup_size with omitted dimensions as 1. Only set if all
+  /// dimensions could be evaluated, overrides count with their defaults.
+  std::optional<std::array<uint32_t, 3>> workgroupSize;
+  /// Vertex buffer layouts of vertex entry points with all attributes in
+  /// buffer 0, see vertexBufferLayouts(). Not set if a location cannot be
+  /// evaluated or an input type is no vertex format.
+  std::optional<std::vector<VertexBufferLayout>> vertexBuffers;
+
+  /// Hash of the function's interface: name, attributes, inputs, return
+  /// type and outputs, with structs resolved. Independent of the body,
+  /// comments and whitespace.
+  uint64_t fingerprint{0};
 };
 
-void to_json(nlohmann::json& j, const Function& function);
+template <typename BasicJson>
+void to_json(BasicJson& j, const Function& function);
 
 struct Binding {
-  explicit Binding(cppts::Node node);
+  /// @group and @binding may refer to `constants`, the initializers of
+  /// module scope constants and overrides by name. Throws std::domain_error
+  /// if either cannot be evaluated or is not below UNSET.
+  explicit Binding(
+      cppts::Node node,
+      const std::unordered_map<std::string, std::string>& constants = {});
   Binding(const Binding& other) = default;
 
   Binding& operator=(const Binding& other) = default;
@@ -76,79 +210,254 @@ struct Binding {
   std::string name;
   std::string bindingType;
   std::string type;
+  /// Address space and access mode of buffers, e.g. "storage" and "read".
+  /// Storage textures have an access mode as well.
+  std::string addressSpace;
+  std::string accessMode;
+  /// Sampled type of textures declared with one, e.g. "f32"
+  std::string sampleType;
+  /// View dimension of textures, e.g. "2d" or "cube_array"
+  std::string viewDimension;
+  bool multisampled{false};
+  /// Texel format of storage textures, e.g. "rgba8unorm"
+  std::string texelFormat;
+  SourceLocation location;
 };
 
-void to_json(nlohmann::json& j, const Binding& binding);
+template <typename BasicJson>
+void to_json(BasicJson& j, const Binding& binding);
 
+/// Declared bindings of one group, sorted by binding number, so that sparse
+/// binding numbers cost no memory
 struct BindGroup {
+  uint32_t group() const { return m_group; }
+
   const auto& bindings() const { return m_bindings; }
-  const auto& binding(size_t i) const { return m_bindings.at(i); }
 
+  /// Binding `number`, or nullptr if the group does not declare it
+  const Binding* binding(uint32_t number) const;
+
+  /// Number of declared bindings
   size_t size() const { return m_bindings.size(); }
 
-  const auto& operator[](size_t i) const { return binding(i); }
+  const Binding* operator[](uint32_t number) const { return binding(number); }
 
  private:
   friend Reflect;
-  std::vector<std::optional<Binding>> m_bindings;
+  friend CallGraph;
+  uint32_t m_group{0};
+  std::vector<Binding> m_bindings;
+};
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const BindGroup& bindGroup);
+
+/// Entry points of each shader stage, as indices into Reflect::functions().
+struct EntryPoints {
+  std::vector<size_t> vertex;
+  std::vector<size_t> fragment;
+  std::vector<size_t> compute;
+};
+
+/// Replacement of the bytes [start, end) of a source by `text`
+struct SourceEdit {
+  size_t start;
+  size_t end;
+  std::string text;
 };
 
-void to_json(nlohmann::json& j, const BindGroup& bindGroup);
+struct ReflectOptions {
+  /// Number of threads extracting top level declarations in parallel. 0
+  /// uses one thread per hardware thread.
+  size_t threads{1};
+
+  /// Time budget for parsing and extraction together. Zero disables the
+  /// limit.
+  std::chrono::microseconds timeout{0};
+
+  /// Reflection is aborted as soon as this flag becomes non-zero. It has to
+  /// outlive the Reflect constructor.
+  const std::atomic<size_t>* cancel{nullptr};
+
+  /// Only reflect bind groups. The source is pre-scanned for declarations
+  /// with @group or @binding attributes and for constants and overrides,
+  /// and only those are parsed, so functions, structures and entry points
+  /// stay empty and the reflection has no tree for variants and call graphs.
+  bool bindingsOnly{false};
+
+  /// Release the parser, tree and source once extraction is done, see
+  /// Reflect::detach()
+  bool detach{false};
+};
+
+/// Approximate heap memory held by a reflection, in bytes
+struct MemoryUsage {
+  /// Source text, shared with the tree, with variants and with other
+  /// reflections of the same host buffer
+  size_t source{0};
+  /// Syntax tree. Estimated from the number of nodes, as tree-sitter does
+  /// not report its allocations.
+  size_t tree{0};
+  /// Whether a parser is held. Its buffers are not counted.
+  bool parser{false};
+  /// Functions, structures, bindings, constants and their indices
+  size_t model{0};
+
+  size_t total() const { return source + tree + model; }
+};
+
+/// Thrown when reflection was cancelled or exceeded its time budget
+class ReflectAborted : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
 
 class Reflect {
  public:
-  explicit Reflect(const std::filesystem::path& source_file);
-  explicit Reflect(const std::string& source);
+  using Options = ReflectOptions;
 
-  const auto& functions() const { return m_functions; }
+  explicit Reflect(const std::filesystem::path& source_file,
+                   const Options& options = {});
+  explicit Reflect(const std::string& source, const Options& options = {});
+  /// Reflect the WGSL in `range` of `host`, e.g. a raw string literal in a
+  /// C++ file, see findEmbeddedWgsl(). The host is parsed in place with only
+  /// `range` included, so source() is the host and locations refer to it.
+  Reflect(const std::string& host, SourceRange range,
+          const Options& options = {});
+  /// Reflect a range of a host buffer shared with the caller, so that the
+  /// reflections of several regions hold one copy of the host
+  Reflect(std::shared_ptr<const std::string> host, SourceRange range,
+          const Options& options = {});
 
-  const auto& function(const std::string& name) const {
-    return m_functions.at(name);
-  }
+  Reflect(Reflect&& other) noexcept;
+  Reflect& operator=(Reflect&& other) noexcept;
 
-  const auto& structures() const { return m_structures; }
-  const auto& structure(const std::string& name) const {
-    return m_structures.at(name);
-  }
+  /// Functions in source order
+  auto functions() const { return detail::records(m_functions); }
+
+  const Function& function(const std::string& name) const;
+
+  /// Structures in source order
+  auto structures() const { return detail::records(m_structures); }
+  const Structure& structure(const std::string& name) const;
 
   [[nodiscard]] const auto& entries() const { return m_entries; }
   [[nodiscard]] const Function& fragment(size_t i) const;
   [[nodiscard]] const Function& vertex(size_t i) const;
   [[nodiscard]] const Function& compute(size_t i) const;
 
+  /// Groups with at least one binding, sorted by group number
   const auto& bindGroups() const { return m_bindGroups; }
-  const auto& bindGroup(size_t i) const { return m_bindGroups.at(i); }
+  /// Group `group`, or nullptr if no binding is declared in it
+  const BindGroup* bindGroup(uint32_t group) const;
+
+  /// Binding `number` of group `group`, or nullptr
+  const Binding* binding(uint32_t group, uint32_t number) const;
+  /// Binding declared as `name`, or nullptr
+  const Binding* binding(const std::string& name) const;
+
+  /// Hash of the module interface: entry points, bindings and structures.
+  /// It only changes when one of them does, see Function::fingerprint for
+  /// the entry points' own hashes.
+  uint64_t fingerprint() const { return m_fingerprint; }
+
+  /// Empty once detached
+  std::string_view source() const {
+    return m_source ? std::string_view{*m_source} : std::string_view{};
+  }
+  /// Range of source() holding the WGSL, if it is embedded in a host file
+  const auto& embedded() const { return m_embedded; }
+
+  /// Release the parser, the tree and the source, keeping only the
+  /// extracted model. Variants, call graphs and minification need them and
+  /// throw std::logic_error for detached reflections; composition still
+  /// works.
+  void detach();
+
+  MemoryUsage memoryUsage() const;
+
+  /// Reflection of this module's source with `edits` applied, e.g. one
+  /// permutation of an uber-shader. The variant is parsed incrementally from
+  /// this module's tree with its parser, and only declarations whose text
+  /// changed are extracted again. The others are shared with this
+  /// reflection. Edits must not overlap. WGSL embedded in a host file has no
+  /// variants.
+  Reflect variant(std::span<const SourceEdit> edits) const;
 
   ~Reflect();
 
  private:
-  void initialize();
+  friend ModuleGraph;
+  friend CallGraph;
+  friend Minifier;
+
+  /// Compose the declarations of several units, earlier units first. Struct
+  /// inputs and outputs of functions are resolved against all units'
+  /// structures. Records are shared with the units, except for functions
+  /// with struct inputs or outputs from another unit.
+  explicit Reflect(std::span<const Reflect* const> units);
+
+  Reflect(const Reflect& base, std::span<const SourceEdit> edits);
+
+  void initialize(const Options& options);
 
-  void parseStructures();
+  void parseStructures(const std::vector<cppts::ByteRange>& chunks);
 
-  void parseFunctions();
+  void parseFunctions(const std::vector<cppts::ByteRange>& chunks);
 
   void parseEntrypoints();
 
-  void parseBindGroups();
+  void parseBindGroups(cppts::Tree& parsed,
+                       const std::vector<cppts::ByteRange>& chunks);
+
+  /// Parse only the pre-scanned binding declarations
+  void parseBindingsOnly();
+
+  /// Initializers of module scope constants and overrides
+  void parseConstants(cppts::Tree& parsed);
+
+  /// Evaluate locations and workgroup sizes that refer to constants
+  void evaluateAttributes();
 
-  std::string m_source;
+  /// Index `bindings` by group, binding number and name. Of several
+  /// bindings with the same numbers the last one is kept.
+  void setBindings(std::vector<Binding> bindings);
 
-  std::unique_ptr<cppts::Parser> m_parser{nullptr};
+  void computeFingerprint();
+
+  /// Throws ReflectAborted once cancelled or past the deadline
+  void checkAborted() const;
+
+  /// Shared with the tree
+  std::shared_ptr<const std::string> m_source;
+  std::optional<SourceRange> m_embedded;
+
+  const std::atomic<size_t>* m_cancel{nullptr};
+  std::optional<std::chrono::steady_clock::time_point> m_deadline;
+
+  /// Shared with variants
+  std::shared_ptr<detail::SharedParser> m_parser{nullptr};
   std::unique_ptr<cppts::Tree> m_tree{nullptr};
 
-  struct {
-    std::vector<std::reference_wrapper<Function>> vertex;
-    std::vector<std::reference_wrapper<Function>> fragment;
-    std::vector<std::reference_wrapper<Function>> compute;
-  } m_entries;
+  EntryPoints m_entries;
+
+  /// Records are immutable, so that variants and compositions share the
+  /// unchanged ones
+  std::vector<std::shared_ptr<const Function>> m_functions;
+  std::unordered_map<std::string, size_t> m_functionIndex;
+  std::vector<std::shared_ptr<const Structure>> m_structures;
+  std::unordered_map<std::string, size_t> m_structureIndex;
+
+  std::vector<BindGroup> m_bindGroups;
+  /// Group and position within the group of each binding, by name
+  std::unordered_map<std::string, std::pair<size_t, size_t>> m_bindingIndex;
 
-  std::unordered_map<std::string, Function> m_functions;
-  std::unordered_map<std::string, Structure> m_structures;
+  std::unordered_map<std::string, std::string> m_constants;
 
-  std::vector<std::optional<BindGroup>> m_bindGroups;
+  uint64_t m_fingerprint{0};
 };
 
-void to_json(nlohmann::json& j, const Reflect& reflect);
+template <typename BasicJson>
+void to_json(BasicJson& j, const Reflect& reflect);
 
 }  // namespace wgsl_reflect
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "wgsl_reflect/reflect.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace wgsl_reflect {
+
+/// Line delimited JSON-RPC 2.0 server keeping open documents and their
+/// reflection results resident.
+///
+/// Methods, all taking a document `uri`:
+/// - `open` / `change` with the full `text`, or `change` with `edits`, a
+///   list of `{start, end, text}` byte range replacements applied in order.
+///   Edits reparse the cached model incrementally.
+/// - `close`
+/// - `reflect`, `bindings`, `entryPoints`, `layout` (the canonical
+///   layouts of the bind groups with bindings, with their group numbers)
+///   and `vertexBuffers` (the default vertex buffer layouts by vertex entry
+///   point), answered from the cached model of the document until it
+///   changes
+class Server {
+ public:
+  explicit Server(const Reflect::Options& options = {});
+
+  /// Handle one request line. Returns the response line, or nothing for
+  /// notifications.
+  std::optional<std::string> handle(std::string_view line);
+
+  /// Serve requests from `in` until it is exhausted.
+  void run(std::istream& in, std::ostream& out);
+
+  size_t documentCount() const { return m_documents.size(); }
+
+ private:
+  struct Document {
+    std::string text;
+    std::optional<Reflect> model;
+    /// Serialized results per method
+    std::unordered_map<std::string, std::string> results;
+  };
+
+  /// Serialized result of `method` for the document in `params`, computed
+  /// on first use
+  const std::string& result(const std::string& method,
+                            const nlohmann::json& params);
+
+  Document& document(const nlohmann::json& params);
+
+  Reflect::Options m_options;
+  std::unordered_map<std::string, Document> m_documents;
+};
+
+}  // namespace wgsl_reflect
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <nlohmann/json_fwd.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace wgsl_reflect {
+
+/// Vertex attribute formats, as in WebGPU's GPUVertexFormat
+enum class VertexFormat {
+  Float16x2,
+  Float16x4,
+  Float32,
+  Float32x2,
+  Float32x3,
+  Float32x4,
+  Uint32,
+  Uint32x2,
+  Uint32x3,
+  Uint32x4,
+  Sint32,
+  Sint32x2,
+  Sint32x3,
+  Sint32x4,
+};
+
+/// WebGPU name of a format, e.g. "float32x3"
+std::string_view formatName(VertexFormat format);
+
+/// Size of a format in bytes
+uint32_t formatSize(VertexFormat format);
+
+/// Format of a WGSL vertex input type like "vec3<f32>" or "vec4f". Throws
+/// std::domain_error for types that cannot be vertex inputs.
+VertexFormat vertexFormat(std::string_view type);
+
+struct VertexAttribute {
+  VertexFormat format;
+  uint64_t offset;
+  uint32_t shaderLocation;
+
+  bool operator==(const VertexAttribute& other) const = default;
+};
+
+struct VertexBufferLayout {
+  uint64_t arrayStride{0};
+  /// Attributes ordered by location, tightly packed
+  std::vector<VertexAttribute> attributes;
+
+  bool operator==(const VertexBufferLayout& other) const = default;
+};
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const VertexBufferLayout& layout);
+
+}  // namespace wgsl_reflect
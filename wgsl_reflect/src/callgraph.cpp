@@ -0,0 +1,209 @@
+#include "wgsl_reflect/callgraph.hpp"
+
+#include "cppts/tree.hpp"
+#include "wgsl_reflect/ast.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace wgsl_reflect {
+
+namespace {
+/// Identifiers in `node` in source order, except attribute names
+void collectIdentifiers(cppts::Node node,
+                        std::vector<std::string_view>& identifiers) {
+  if (node.is(ast::symbol::identifier)) {
+    identifiers.push_back(node.str());
+    return;
+  }
+  bool attribute = node.is(ast::symbol::attribute);
+  bool first = true;
+  for (auto child : node.namedChildren()) {
+    if (attribute && std::exchange(first, false)) {
+      continue;
+    }
+    collectIdentifiers(child, identifiers);
+  }
+}
+
+/// First identifier outside of attributes, the name of constants, aliases
+/// and the like
+std::string_view firstName(cppts::Node node) {
+  if (node.is(ast::symbol::identifier)) {
+    return node.str();
+  }
+  for (auto child : node.namedChildren()) {
+    if (child.is(ast::symbol::attribute)) {
+      continue;
+    }
+    if (auto name = firstName(child); !name.empty()) {
+      return name;
+    }
+  }
+  return {};
+}
+
+Declaration makeDeclaration(cppts::Node node) {
+  Declaration decl{DeclarationKind::Other, "", node.start(), node.end(), {}};
+  if (auto function = ast::FunctionDeclaration::cast(node); function) {
+    decl.kind = DeclarationKind::Function;
+    decl.name = function->name().str();
+  } else if (auto structure = ast::StructDeclaration::cast(node);
+             structure) {
+    decl.kind = DeclarationKind::Structure;
+    decl.name = structure->name().str();
+  } else if (node.is(ast::symbol::global_variable_declaration)) {
+    decl.kind = DeclarationKind::Variable;
+    decl.name = firstName(node);
+  } else if (auto keyword = node.child(0).str(); keyword == "enable" ||
+                                                   keyword == "requires" ||
+                                                   keyword == "diagnostic") {
+    decl.kind = DeclarationKind::Directive;
+  } else {
+    decl.name = firstName(node);
+  }
+  return decl;
+}
+}  // namespace
+
+CallGraph::CallGraph(const Reflect& reflect) : m_reflect{&reflect} {
+  if (!reflect.m_tree) {
+    throw std::logic_error{"Call graphs need a reflection parsed from source"};
+  }
+
+  std::vector<cppts::Node> nodes;
+  for (auto node : reflect.m_tree->rootNode().namedChildren()) {
+    if (node.isExtra()) {
+      continue;
+    }
+    m_declarations.push_back(makeDeclaration(node));
+    nodes.push_back(node);
+    if (!m_declarations.back().name.empty()) {
+      m_index.emplace(m_declarations.back().name, m_declarations.size() - 1);
+    }
+  }
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    std::vector<std::string_view> identifiers;
+    collectIdentifiers(nodes[i], identifiers);
+    auto& references = m_declarations[i].references;
+    for (auto identifier : identifiers) {
+      auto it = m_index.find(std::string{identifier});
+      if (it == m_index.end() || it->second == i ||
+          std::find(references.begin(), references.end(), it->second) !=
+              references.end()) {
+        continue;
+      }
+      references.push_back(it->second);
+    }
+  }
+
+  // Valid WGSL has no cycles, but shadowing can make up references. A set
+  // computed while one of its references was still in progress misses that
+  // part and is not kept, except for the outermost call, which is complete.
+  enum class State { New, InProgress, Done };
+  std::vector<State> states(m_declarations.size(), State::New);
+  m_reachable.resize(m_declarations.size());
+
+  std::function<bool(size_t, std::vector<size_t>&)> visit =
+      [&](size_t i, std::vector<size_t>& reached) {
+        if (states[i] == State::Done) {
+          reached = m_reachable[i];
+          return true;
+        }
+        states[i] = State::InProgress;
+        bool complete = true;
+        reached = {i};
+        for (size_t ref : m_declarations[i].references) {
+          if (states[ref] == State::InProgress) {
+            complete = false;
+            continue;
+          }
+          std::vector<size_t> sub;
+          complete &= visit(ref, sub);
+          reached.insert(reached.end(), sub.begin(), sub.end());
+        }
+        std::sort(reached.begin(), reached.end());
+        reached.erase(std::unique(reached.begin(), reached.end()),
+                      reached.end());
+        states[i] = complete ? State::Done : State::New;
+        if (complete) {
+          m_reachable[i] = reached;
+        }
+        return complete;
+      };
+
+  for (size_t i = 0; i < m_declarations.size(); i++) {
+    if (states[i] != State::Done) {
+      visit(i, m_reachable[i]);
+      states[i] = State::Done;
+    }
+  }
+}
+
+size_t CallGraph::index(const std::string& name) const {
+  auto it = m_index.find(name);
+  if (it == m_index.end()) {
+    throw std::out_of_range{"No declaration named " + name};
+  }
+  return it->second;
+}
+
+const Declaration& CallGraph::declaration(const std::string& name) const {
+  return m_declarations[index(name)];
+}
+
+std::vector<std::string> CallGraph::calls(const std::string& function) const {
+  std::vector<std::string> result;
+  for (size_t ref : declaration(function).references) {
+    if (m_declarations[ref].kind == DeclarationKind::Function) {
+      result.push_back(m_declarations[ref].name);
+    }
+  }
+  return result;
+}
+
+const std::vector<size_t>& CallGraph::reachable(const std::string& name) const {
+  return m_reachable[index(name)];
+}
+
+std::vector<BindGroup> CallGraph::bindGroups(const std::string& entry) const {
+  const auto& reached = reachable(entry);
+  std::vector<BindGroup> groups;
+  for (const auto& group : m_reflect->bindGroups()) {
+    BindGroup used;
+    used.m_group = group.group();
+    for (const auto& binding : group.bindings()) {
+      auto it = m_index.find(binding.name);
+      if (it != m_index.end() &&
+          std::binary_search(reached.begin(), reached.end(), it->second)) {
+        used.m_bindings.push_back(binding);
+      }
+    }
+    if (used.size() > 0) {
+      groups.push_back(std::move(used));
+    }
+  }
+  return groups;
+}
+
+std::string CallGraph::strip(const std::string& entry) const {
+  const auto& reached = reachable(entry);
+  auto source = m_reflect->source();
+  std::string result;
+  for (size_t i = 0; i < m_declarations.size(); i++) {
+    const auto& decl = m_declarations[i];
+    if (decl.kind != DeclarationKind::Directive &&
+        !std::binary_search(reached.begin(), reached.end(), i)) {
+      continue;
+    }
+    result += source.substr(decl.start, decl.end - decl.start);
+    result += '\n';
+  }
+  return result;
+}
+
+}  // namespace wgsl_reflect
@@ -0,0 +1,279 @@
+#include "wgsl_reflect/embedded.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <utility>
+
+namespace wgsl_reflect {
+
+namespace {
+bool isIdentifierChar(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+    return std::tolower(static_cast<unsigned char>(x)) ==
+           std::tolower(static_cast<unsigned char>(y));
+  });
+}
+
+std::string_view trim(std::string_view text) {
+  size_t start = text.find_first_not_of(" \t\r");
+  if (start == std::string_view::npos) {
+    return {};
+  }
+  return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+}
+
+/// Position after the comment starting at `pos`, or `pos` if none does
+size_t skipComment(std::string_view source, size_t pos) {
+  if (source.substr(pos, 2) == "//") {
+    return std::min(source.find('\n', pos), source.size());
+  }
+  if (source.substr(pos, 2) == "/*") {
+    size_t end = source.find("*/", pos + 2);
+    return end == std::string_view::npos ? source.size() : end + 2;
+  }
+  return pos;
+}
+
+/// Position after the string or character literal starting at `pos`. An
+/// unterminated literal ends at the end of its line.
+size_t skipQuoted(std::string_view source, size_t pos) {
+  char quote = source[pos];
+  for (size_t i = pos + 1; i < source.size(); i++) {
+    if (source[i] == '\\') {
+      i++;
+    } else if (source[i] == quote) {
+      return i + 1;
+    } else if (source[i] == '\n') {
+      return i;
+    }
+  }
+  return source.size();
+}
+
+/// Position after the template literal starting at `pos`, and whether it
+/// has ${} substitutions
+std::pair<size_t, bool> skipTemplate(std::string_view source, size_t pos) {
+  bool substitutions = false;
+  for (size_t i = pos + 1; i < source.size(); i++) {
+    if (source[i] == '\\') {
+      i++;
+    } else if (source[i] == '`') {
+      return {i + 1, substitutions};
+    } else if (source.substr(i, 2) == "${") {
+      substitutions = true;
+      // the expression may hold braces, strings and templates of its own
+      int depth = 0;
+      for (i++; i < source.size(); i++) {
+        if (source[i] == '{') {
+          depth++;
+        } else if (source[i] == '}' && --depth == 0) {
+          break;
+        } else if (source[i] == '"' || source[i] == '\'') {
+          i = skipQuoted(source, i) - 1;
+        } else if (source[i] == '`') {
+          i = skipTemplate(source, i).first - 1;
+        }
+      }
+    }
+  }
+  return {source.size(), substitutions};
+}
+
+std::vector<SourceRange> scanCpp(std::string_view source) {
+  std::vector<SourceRange> result;
+  size_t i = 0;
+  while (i < source.size()) {
+    char c = source[i];
+    if (size_t end = skipComment(source, i); end != i) {
+      i = end;
+      continue;
+    }
+    if (c == '"' || c == '\'') {
+      i = skipQuoted(source, i);
+      continue;
+    }
+    if (!isIdentifierChar(c)) {
+      i++;
+      continue;
+    }
+
+    // whole identifiers and numbers, with digit separators
+    size_t start = i;
+    bool number = std::isdigit(static_cast<unsigned char>(c)) != 0;
+    while (i < source.size() &&
+           (isIdentifierChar(source[i]) || (number && source[i] == '\''))) {
+      i++;
+    }
+    std::string_view word = source.substr(start, i - start);
+    if (i == source.size() || source[i] != '"' ||
+        (word != "R" && word != "LR" && word != "uR" && word != "UR" &&
+         word != "u8R")) {
+      continue;
+    }
+
+    // R"delimiter(...)delimiter", delimiters have at most 16 characters
+    size_t open = source.find('(', i + 1);
+    if (open == std::string_view::npos || open - i - 1 > 16) {
+      i++;
+      continue;
+    }
+    std::string_view delimiter = source.substr(i + 1, open - i - 1);
+    std::string closing = ")" + std::string{delimiter} + "\"";
+    size_t close = source.find(closing, open + 1);
+    if (close == std::string_view::npos) {
+      break;
+    }
+    if (equalsIgnoreCase(delimiter, "wgsl")) {
+      result.push_back(SourceRange{open + 1, close});
+    }
+    i = close + closing.size();
+  }
+  return result;
+}
+
+std::vector<SourceRange> scanJavaScript(std::string_view source) {
+  std::vector<SourceRange> result;
+  // whether the next template literal holds WGSL
+  bool tagged = false;
+  size_t i = 0;
+  while (i < source.size()) {
+    char c = source[i];
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      i++;
+      continue;
+    }
+    if (size_t end = skipComment(source, i); end != i) {
+      tagged = source[i + 1] == '*' && end - i >= 4 &&
+               source.substr(end - 2, 2) == "*/" &&
+               equalsIgnoreCase(trim(source.substr(i + 2, end - i - 4)),
+                                "wgsl");
+      i = end;
+      continue;
+    }
+    if (c == '"' || c == '\'') {
+      i = skipQuoted(source, i);
+      tagged = false;
+      continue;
+    }
+    if (c == '`') {
+      auto [end, substitutions] = skipTemplate(source, i);
+      bool closed = end - 1 > i && source[end - 1] == '`';
+      if (tagged && closed && !substitutions) {
+        result.push_back(SourceRange{i + 1, end - 1});
+      }
+      tagged = false;
+      i = end;
+      continue;
+    }
+    if (isIdentifierChar(c)) {
+      size_t start = i;
+      while (i < source.size() && isIdentifierChar(source[i])) {
+        i++;
+      }
+      tagged = source.substr(start, i - start) == "wgsl";
+      continue;
+    }
+    tagged = false;
+    i++;
+  }
+  return result;
+}
+
+std::vector<SourceRange> scanMarkdown(std::string_view source) {
+  std::vector<SourceRange> result;
+  // the open fence, if any
+  char fence = 0;
+  size_t fenceLength = 0;
+  bool wgsl = false;
+  size_t contentStart = 0;
+
+  size_t lineStart = 0;
+  while (lineStart < source.size()) {
+    size_t lineEnd = std::min(source.find('\n', lineStart), source.size());
+    std::string_view line = source.substr(lineStart, lineEnd - lineStart);
+    lineStart = lineEnd + 1;
+
+    // fences are indented by at most three spaces
+    size_t indent = line.find_first_not_of(' ');
+    if (indent == std::string_view::npos || indent > 3 ||
+        (line[indent] != '`' && line[indent] != '~')) {
+      continue;
+    }
+    char c = line[indent];
+    size_t length =
+        std::min(line.find_first_not_of(c, indent), line.size()) - indent;
+    std::string_view info = trim(line.substr(indent + length));
+
+    if (fence == 0 && length >= 3 &&
+        (c == '~' || info.find('`') == std::string_view::npos)) {
+      fence = c;
+      fenceLength = length;
+      wgsl = equalsIgnoreCase(info.substr(0, info.find_first_of(" \t{")),
+                              "wgsl");
+      contentStart = std::min(lineStart, source.size());
+    } else if (fence == c && length >= fenceLength && info.empty()) {
+      if (wgsl) {
+        result.push_back(SourceRange{contentStart, lineEnd - line.size()});
+      }
+      fence = 0;
+    }
+  }
+  // unclosed blocks end with the document
+  if (fence != 0 && wgsl) {
+    result.push_back(SourceRange{contentStart, source.size()});
+  }
+  return result;
+}
+}  // namespace
+
+std::optional<HostLanguage> hostLanguage(const std::filesystem::path& path) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  for (const char* cpp :
+       {".cpp", ".cc", ".cxx", ".c++", ".h", ".hpp", ".hh", ".hxx", ".inl"}) {
+    if (extension == cpp) {
+      return HostLanguage::Cpp;
+    }
+  }
+  for (const char* js :
+       {".js", ".mjs", ".cjs", ".jsx", ".ts", ".mts", ".cts", ".tsx"}) {
+    if (extension == js) {
+      return HostLanguage::JavaScript;
+    }
+  }
+  if (extension == ".md" || extension == ".markdown") {
+    return HostLanguage::Markdown;
+  }
+  return std::nullopt;
+}
+
+std::vector<SourceRange> findEmbeddedWgsl(std::string_view source,
+                                          HostLanguage language) {
+  switch (language) {
+    case HostLanguage::Cpp:
+      return scanCpp(source);
+    case HostLanguage::JavaScript:
+      return scanJavaScript(source);
+    case HostLanguage::Markdown:
+      return scanMarkdown(source);
+  }
+  return {};
+}
+
+SourceLocation locate(std::string_view source, size_t offset) {
+  offset = std::min(offset, source.size());
+  auto head = source.substr(0, offset);
+  size_t lineStart = head.rfind('\n');
+  lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+  return SourceLocation{
+      offset, static_cast<uint32_t>(std::count(head.begin(), head.end(), '\n')),
+      static_cast<uint32_t>(offset - lineStart)};
+}
+
+}  // namespace wgsl_reflect
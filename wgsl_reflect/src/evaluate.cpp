@@ -0,0 +1,332 @@
+#include "evaluate.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <limits>
+
+namespace wgsl_reflect::detail {
+
+namespace {
+/// Thrown for anything that is not a supported constant expression,
+/// including overflowing ones
+struct Unsupported {};
+
+constexpr int64_t minValue = std::numeric_limits<int64_t>::min();
+constexpr int64_t maxValue = std::numeric_limits<int64_t>::max();
+
+int64_t add(int64_t a, int64_t b) {
+  if (b > 0 ? a > maxValue - b : a < minValue - b) {
+    throw Unsupported{};
+  }
+  return a + b;
+}
+
+int64_t subtract(int64_t a, int64_t b) {
+  if (b < 0 ? a > maxValue + b : a < minValue + b) {
+    throw Unsupported{};
+  }
+  return a - b;
+}
+
+int64_t multiply(int64_t a, int64_t b) {
+  bool overflow = a > 0 ? (b > 0 ? a > maxValue / b : b < minValue / a)
+                        : (b > 0 ? a < minValue / b
+                                 : a != 0 && b < maxValue / a);
+  if (overflow) {
+    throw Unsupported{};
+  }
+  return a * b;
+}
+
+int64_t negate(int64_t a) {
+  if (a == minValue) {
+    throw Unsupported{};
+  }
+  return -a;
+}
+
+/// Recursive descent over the expression text, from the weakest binding
+/// operator to the strongest
+class Evaluator {
+ public:
+  /// `depth` is the nesting of the expression this one was reached from
+  Evaluator(std::string_view text, const Constants& constants, int depth)
+      : m_text{text}, m_constants{&constants}, m_depth{depth} {}
+
+  int64_t evaluate() {
+    int64_t value = bitOr();
+    skipSpace();
+    if (m_pos != m_text.size()) {
+      throw Unsupported{};
+    }
+    return value;
+  }
+
+ private:
+  /// Bounds the recursion of parentheses, calls, unary operators and
+  /// constants referring to constants while it lives
+  class Nested {
+   public:
+    explicit Nested(int& depth) : m_depth{depth} {
+      // constants referring to each other in a cycle are invalid WGSL
+      if (++m_depth > 64) {
+        throw Unsupported{};
+      }
+    }
+    ~Nested() { m_depth--; }
+
+    Nested(const Nested&) = delete;
+    Nested& operator=(const Nested&) = delete;
+
+   private:
+    int& m_depth;
+  };
+
+  void skipSpace() {
+    while (m_pos < m_text.size() &&
+           std::isspace(static_cast<unsigned char>(m_text[m_pos]))) {
+      m_pos++;
+    }
+  }
+
+  /// Consume `op` unless it is the start of a longer operator
+  bool accept(std::string_view op) {
+    skipSpace();
+    if (m_text.substr(m_pos, op.size()) != op) {
+      return false;
+    }
+    if ((op == "|" || op == "&") && m_pos + 1 < m_text.size() &&
+        m_text[m_pos + 1] == op[0]) {
+      // logical operators
+      return false;
+    }
+    m_pos += op.size();
+    return true;
+  }
+
+  int64_t bitOr() {
+    int64_t value = bitXor();
+    while (accept("|")) {
+      value |= bitXor();
+    }
+    return value;
+  }
+
+  int64_t bitXor() {
+    int64_t value = bitAnd();
+    while (accept("^")) {
+      value ^= bitAnd();
+    }
+    return value;
+  }
+
+  int64_t bitAnd() {
+    int64_t value = shift();
+    while (accept("&")) {
+      value &= shift();
+    }
+    return value;
+  }
+
+  int64_t shift() {
+    int64_t value = additive();
+    while (true) {
+      bool left = accept("<<");
+      if (left || accept(">>")) {
+        int64_t amount = additive();
+        if (amount < 0 || amount > 62 ||
+            (left && (value > maxValue >> amount ||
+                      value < minValue >> amount))) {
+          throw Unsupported{};
+        }
+        value = left ? value << amount : value >> amount;
+      } else {
+        return value;
+      }
+    }
+  }
+
+  int64_t additive() {
+    int64_t value = multiplicative();
+    while (true) {
+      if (accept("+")) {
+        value = add(value, multiplicative());
+      } else if (accept("-")) {
+        value = subtract(value, multiplicative());
+      } else {
+        return value;
+      }
+    }
+  }
+
+  int64_t multiplicative() {
+    int64_t value = unary();
+    while (true) {
+      if (accept("*")) {
+        value = multiply(value, unary());
+      } else if (accept("/") || accept("%")) {
+        bool divide = m_text[m_pos - 1] == '/';
+        int64_t divisor = unary();
+        if (divisor == 0 || (value == minValue && divisor == -1)) {
+          throw Unsupported{};
+        }
+        value = divide ? value / divisor : value % divisor;
+      } else {
+        return value;
+      }
+    }
+  }
+
+  int64_t unary() {
+    if (accept("-")) {
+      Nested nested{m_depth};
+      return negate(unary());
+    }
+    if (accept("~")) {
+      Nested nested{m_depth};
+      return ~unary();
+    }
+    return primary();
+  }
+
+  int64_t primary() {
+    skipSpace();
+    if (m_pos == m_text.size()) {
+      throw Unsupported{};
+    }
+    char c = m_text[m_pos];
+    if (accept("(")) {
+      Nested nested{m_depth};
+      int64_t value = bitOr();
+      if (!accept(")")) {
+        throw Unsupported{};
+      }
+      return value;
+    }
+    if (std::isdigit(static_cast<unsigned char>(c))) {
+      return number();
+    }
+    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      return identifier();
+    }
+    throw Unsupported{};
+  }
+
+  int64_t number() {
+    int base = 10;
+    if (m_text.substr(m_pos, 2) == "0x" || m_text.substr(m_pos, 2) == "0X") {
+      base = 16;
+      m_pos += 2;
+    }
+    std::string digits;
+    while (m_pos < m_text.size() &&
+           std::isxdigit(static_cast<unsigned char>(m_text[m_pos])) &&
+           (base == 16 ||
+            std::isdigit(static_cast<unsigned char>(m_text[m_pos])))) {
+      digits += m_text[m_pos++];
+    }
+    if (digits.empty()) {
+      throw Unsupported{};
+    }
+    if (m_pos < m_text.size() &&
+        (m_text[m_pos] == 'i' || m_text[m_pos] == 'u')) {
+      m_pos++;
+    }
+    if (m_pos < m_text.size() &&
+        (std::isalnum(static_cast<unsigned char>(m_text[m_pos])) ||
+         m_text[m_pos] == '.' || m_text[m_pos] == '_')) {
+      // floats and other suffixes
+      throw Unsupported{};
+    }
+    int64_t value = 0;
+    auto [end, error] = std::from_chars(
+        digits.data(), digits.data() + digits.size(), value, base);
+    if (error != std::errc{}) {
+      // out of range
+      throw Unsupported{};
+    }
+    return value;
+  }
+
+  int64_t identifier() {
+    size_t start = m_pos;
+    while (m_pos < m_text.size() &&
+           (std::isalnum(static_cast<unsigned char>(m_text[m_pos])) ||
+            m_text[m_pos] == '_')) {
+      m_pos++;
+    }
+    std::string name{m_text.substr(start, m_pos - start)};
+
+    if (accept("(")) {
+      Nested nested{m_depth};
+      std::vector<int64_t> args;
+      if (!accept(")")) {
+        do {
+          args.push_back(bitOr());
+        } while (accept(","));
+        if (!accept(")")) {
+          throw Unsupported{};
+        }
+      }
+      if ((name == "i32" || name == "u32") && args.size() == 1) {
+        return args[0];
+      } else if (name == "abs" && args.size() == 1) {
+        return args[0] < 0 ? negate(args[0]) : args[0];
+      } else if (name == "min" && args.size() == 2) {
+        return std::min(args[0], args[1]);
+      } else if (name == "max" && args.size() == 2) {
+        return std::max(args[0], args[1]);
+      }
+      throw Unsupported{};
+    }
+
+    auto it = m_constants->find(name);
+    if (it == m_constants->end()) {
+      throw Unsupported{};
+    }
+    Nested nested{m_depth};
+    return Evaluator{it->second, *m_constants, m_depth}.evaluate();
+  }
+
+  std::string_view m_text;
+  const Constants* m_constants;
+  int m_depth;
+  size_t m_pos{0};
+};
+}  // namespace
+
+std::optional<int64_t> evaluate(std::string_view expression,
+                                const Constants& constants) {
+  try {
+    return Evaluator{expression, constants, 0}.evaluate();
+  } catch (const Unsupported&) {
+    return std::nullopt;
+  }
+}
+
+std::vector<std::string_view> splitArguments(std::string_view arguments) {
+  std::vector<std::string_view> result;
+  int depth = 0;
+  size_t start = 0;
+  for (size_t i = 0; i < arguments.size(); i++) {
+    char c = arguments[i];
+    if (c == '(') {
+      depth++;
+    } else if (c == ')') {
+      depth--;
+    } else if (c == ',' && depth == 0) {
+      result.push_back(arguments.substr(start, i - start));
+      start = i + 1;
+    }
+  }
+  auto last = arguments.substr(start);
+  // trailing commas are allowed
+  if (last.find_first_not_of(" \t\r\n") != std::string_view::npos ||
+      result.empty()) {
+    result.push_back(last);
+  }
+  return result;
+}
+
+}  // namespace wgsl_reflect::detail
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace wgsl_reflect::detail {
+
+/// Initializers of module scope constants and overrides by name
+using Constants = std::unordered_map<std::string, std::string>;
+
+/// Value of an integer constant expression, e.g. "WG_SIZE * 2u". Supported
+/// are integer literals, the given constants, arithmetic, bit and shift
+/// operators, parentheses and the i32, u32, min, max and abs builtins.
+/// Anything else, including overflow and deep nesting, gives no value.
+std::optional<int64_t> evaluate(std::string_view expression,
+                                const Constants& constants = {});
+
+/// Split the arguments of an attribute, e.g. "8, N * 2, 1", at top level
+/// commas
+std::vector<std::string_view> splitArguments(std::string_view arguments);
+
+}  // namespace wgsl_reflect::detail
@@ -0,0 +1,92 @@
+#include "wgsl_reflect/graph.hpp"
+
+#include "hash.hpp"
+
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+namespace wgsl_reflect {
+
+ModuleGraph::ModuleGraph(const Reflect::Options& options)
+    : m_options{options} {}
+
+void ModuleGraph::add(const std::string& name, const std::string& source,
+                      std::vector<std::string> imports) {
+  uint64_t hash = detail::Hasher{}.add(source).value();
+
+  std::shared_ptr<const Reflect> reflect;
+  auto [begin, end] = m_cache.equal_range(hash);
+  for (auto it = begin; it != end; ++it) {
+    const auto& entry = it->second;
+    std::string_view cached =
+        m_options.detach ? entry.source : entry.reflect->source();
+    if (cached == source) {
+      reflect = entry.reflect;
+      break;
+    }
+  }
+  if (!reflect) {
+    reflect = std::make_shared<const Reflect>(source, m_options);
+    m_cache.emplace(hash, CacheEntry{reflect, m_options.detach ? source : ""});
+  }
+
+  m_units.insert_or_assign(name, Unit{std::move(reflect), std::move(imports)});
+  m_composed.clear();
+  evictUnused();
+}
+
+void ModuleGraph::remove(const std::string& name) {
+  m_units.erase(name);
+  m_composed.clear();
+  evictUnused();
+}
+
+void ModuleGraph::evictUnused() {
+  for (auto it = m_cache.begin(); it != m_cache.end();) {
+    if (it->second.reflect.use_count() == 1) {
+      it = m_cache.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+const Reflect& ModuleGraph::unit(const std::string& name) const {
+  auto it = m_units.find(name);
+  if (it == m_units.end()) {
+    throw std::invalid_argument{"Unknown unit " + name};
+  }
+  return *it->second.reflect;
+}
+
+std::shared_ptr<const Reflect> ModuleGraph::compose(const std::string& name) {
+  if (auto it = m_composed.find(name); it != m_composed.end()) {
+    return it->second;
+  }
+
+  // imports in depth first post order, each unit once
+  std::vector<const Reflect*> order;
+  std::unordered_set<std::string> visited;
+  std::function<void(const std::string&)> visit = [&](const std::string& n) {
+    if (!visited.insert(n).second) {
+      return;
+    }
+    auto it = m_units.find(n);
+    if (it == m_units.end()) {
+      throw std::invalid_argument{"Unknown unit " + n};
+    }
+    for (const auto& import : it->second.imports) {
+      visit(import);
+    }
+    order.push_back(it->second.reflect.get());
+  };
+  visit(name);
+
+  auto composed = std::make_shared<const Reflect>(Reflect{order});
+  m_composed.emplace(name, composed);
+  return composed;
+}
+
+}  // namespace wgsl_reflect
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace wgsl_reflect::detail {
+
+/// Incremental 64 bit FNV-1a hash. Strings are length prefixed so that
+/// sequences of fields hash unambiguously.
+class Hasher {
+ public:
+  Hasher& add(uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+      byte(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    return *this;
+  }
+
+  Hasher& add(std::string_view value) {
+    add(static_cast<uint64_t>(value.size()));
+    for (char c : value) {
+      byte(static_cast<uint8_t>(c));
+    }
+    return *this;
+  }
+
+  /// Add a type name, ignoring whitespace inside it
+  Hasher& addType(std::string_view type) {
+    uint64_t size = 0;
+    for (char c : type) {
+      size += !isSpace(c);
+    }
+    add(size);
+    for (char c : type) {
+      if (!isSpace(c)) {
+        byte(static_cast<uint8_t>(c));
+      }
+    }
+    return *this;
+  }
+
+  uint64_t value() const { return m_state; }
+
+ private:
+  static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  void byte(uint8_t b) {
+    m_state ^= b;
+    m_state *= 0x100000001b3ull;
+  }
+
+  uint64_t m_state{0xcbf29ce484222325ull};
+};
+
+}  // namespace wgsl_reflect::detail
@@ -0,0 +1,408 @@
+#include "wgsl_reflect/layout.hpp"
+
+#include "hash.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+
+namespace wgsl_reflect {
+
+namespace {
+std::string resourceType(const Binding& binding) {
+  if (binding.bindingType != "buffer") {
+    return binding.bindingType;
+  }
+  if (binding.addressSpace == "storage") {
+    // storage buffers are read only unless declared otherwise
+    return binding.accessMode.empty() || binding.accessMode == "read"
+               ? "read-only-storage"
+               : "storage";
+  }
+  return binding.addressSpace;
+}
+
+BindGroupLayoutEntry layoutEntry(const Binding& binding, uint32_t visibility) {
+  BindGroupLayoutEntry entry;
+  entry.binding = binding.binding;
+  entry.resource = resourceType(binding);
+  entry.visibility = visibility;
+  if (binding.bindingType.starts_with("texture_depth_")) {
+    entry.sampleType = "depth";
+  } else if (binding.sampleType == "f32") {
+    entry.sampleType = "float";
+  } else if (binding.sampleType == "i32") {
+    entry.sampleType = "sint";
+  } else if (binding.sampleType == "u32") {
+    entry.sampleType = "uint";
+  }
+  entry.viewDimension = binding.viewDimension;
+  std::replace(entry.viewDimension.begin(), entry.viewDimension.end(), '_',
+               '-');
+  entry.multisampled = binding.multisampled;
+  entry.format = binding.texelFormat;
+  if (!binding.texelFormat.empty()) {
+    if (binding.accessMode == "read") {
+      entry.access = "read-only";
+    } else if (binding.accessMode == "read_write") {
+      entry.access = "read-write";
+    } else {
+      entry.access = "write-only";
+    }
+  }
+  return entry;
+}
+
+/// Resource with its texture details, e.g. "texture_2d<float>"
+std::string describe(const BindGroupLayoutEntry& entry) {
+  std::string arguments = entry.sampleType;
+  if (!entry.format.empty()) {
+    arguments = entry.format + ", " + entry.access;
+  }
+  return arguments.empty() ? entry.resource
+                           : entry.resource + "<" + arguments + ">";
+}
+}  // namespace
+
+bool BindGroupLayoutEntry::sameResource(
+    const BindGroupLayoutEntry& other) const {
+  return binding == other.binding && resource == other.resource &&
+         sampleType == other.sampleType &&
+         viewDimension == other.viewDimension &&
+         multisampled == other.multisampled && format == other.format &&
+         access == other.access;
+}
+
+BindGroupLayout::BindGroupLayout(const BindGroup& group, uint32_t visibility) {
+  for (const auto& binding : group.bindings()) {
+    m_entries.push_back(layoutEntry(binding, visibility));
+  }
+  canonicalize();
+}
+
+BindGroupLayout::BindGroupLayout(std::vector<BindGroupLayoutEntry> entries)
+    : m_entries{std::move(entries)} {
+  canonicalize();
+}
+
+void BindGroupLayout::canonicalize() {
+  std::stable_sort(m_entries.begin(), m_entries.end(),
+                   [](const auto& a, const auto& b) {
+                     return a.binding < b.binding;
+                   });
+
+  detail::Hasher hasher;
+  hasher.add(m_entries.size());
+  for (const auto& entry : m_entries) {
+    hasher.add(entry.binding)
+        .add(entry.resource)
+        .add(entry.visibility)
+        .add(entry.sampleType)
+        .add(entry.viewDimension)
+        .add(entry.multisampled)
+        .add(entry.format)
+        .add(entry.access);
+  }
+  m_hash = hasher.value();
+}
+
+const BindGroupLayoutEntry* BindGroupLayout::entry(uint32_t binding) const {
+  auto it = std::lower_bound(
+      m_entries.begin(), m_entries.end(), binding,
+      [](const auto& entry, uint32_t b) { return entry.binding < b; });
+  if (it == m_entries.end() || it->binding != binding) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+const BindGroupLayout* findLayout(std::span<const GroupLayout> layouts,
+                                  uint32_t group) {
+  auto it = std::lower_bound(
+      layouts.begin(), layouts.end(), group,
+      [](const auto& layout, uint32_t g) { return layout.group < g; });
+  if (it == layouts.end() || it->group != group) {
+    return nullptr;
+  }
+  return &it->layout;
+}
+
+std::vector<GroupLayout> bindGroupLayouts(std::span<const BindGroup> groups,
+                                          uint32_t visibility) {
+  std::vector<GroupLayout> layouts;
+  layouts.reserve(groups.size());
+  for (const auto& group : groups) {
+    layouts.push_back(
+        GroupLayout{group.group(), BindGroupLayout{group, visibility}});
+  }
+  std::stable_sort(layouts.begin(), layouts.end(),
+                   [](const auto& a, const auto& b) {
+                     return a.group < b.group;
+                   });
+  return layouts;
+}
+
+std::vector<GroupLayout> bindGroupLayouts(const Reflect& reflect,
+                                          uint32_t visibility) {
+  return bindGroupLayouts(reflect.bindGroups(), visibility);
+}
+
+std::vector<GroupLayout> bindGroupLayouts(const Reflect& reflect) {
+  uint32_t visibility = 0;
+  if (!reflect.entries().vertex.empty()) {
+    visibility |= ShaderStage::Vertex;
+  }
+  if (!reflect.entries().fragment.empty()) {
+    visibility |= ShaderStage::Fragment;
+  }
+  if (!reflect.entries().compute.empty()) {
+    visibility |= ShaderStage::Compute;
+  }
+  return bindGroupLayouts(reflect, visibility);
+}
+
+PipelineLayout mergeLayouts(std::span<const std::vector<GroupLayout>> layouts) {
+  PipelineLayout result;
+  // entries by group, sorted by the map
+  std::map<uint32_t, std::vector<BindGroupLayoutEntry>> merged;
+
+  for (const auto& layout : layouts) {
+    for (const auto& [g, group] : layout) {
+      auto& entries = merged[g];
+      for (const auto& entry : group.entries()) {
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [&](const auto& existing) {
+                                 return existing.binding == entry.binding;
+                               });
+        if (it == entries.end()) {
+          entries.push_back(entry);
+        } else if (!it->sameResource(entry)) {
+          result.conflicts.push_back(LayoutConflict{
+              g, entry.binding, describe(*it), describe(entry)});
+        } else {
+          it->visibility |= entry.visibility;
+        }
+      }
+    }
+  }
+
+  result.groups.reserve(merged.size());
+  for (auto& [g, entries] : merged) {
+    result.groups.push_back(
+        GroupLayout{g, BindGroupLayout{std::move(entries)}});
+  }
+  return result;
+}
+
+std::string_view formatName(VertexFormat format) {
+  switch (format) {
+    case VertexFormat::Float16x2:
+      return "float16x2";
+    case VertexFormat::Float16x4:
+      return "float16x4";
+    case VertexFormat::Float32:
+      return "float32";
+    case VertexFormat::Float32x2:
+      return "float32x2";
+    case VertexFormat::Float32x3:
+      return "float32x3";
+    case VertexFormat::Float32x4:
+      return "float32x4";
+    case VertexFormat::Uint32:
+      return "uint32";
+    case VertexFormat::Uint32x2:
+      return "uint32x2";
+    case VertexFormat::Uint32x3:
+      return "uint32x3";
+    case VertexFormat::Uint32x4:
+      return "uint32x4";
+    case VertexFormat::Sint32:
+      return "sint32";
+    case VertexFormat::Sint32x2:
+      return "sint32x2";
+    case VertexFormat::Sint32x3:
+      return "sint32x3";
+    case VertexFormat::Sint32x4:
+      return "sint32x4";
+  }
+  throw std::invalid_argument{"Unknown vertex format"};
+}
+
+uint32_t formatSize(VertexFormat format) {
+  switch (format) {
+    case VertexFormat::Float16x2:
+    case VertexFormat::Float32:
+    case VertexFormat::Uint32:
+    case VertexFormat::Sint32:
+      return 4;
+    case VertexFormat::Float16x4:
+    case VertexFormat::Float32x2:
+    case VertexFormat::Uint32x2:
+    case VertexFormat::Sint32x2:
+      return 8;
+    case VertexFormat::Float32x3:
+    case VertexFormat::Uint32x3:
+    case VertexFormat::Sint32x3:
+      return 12;
+    case VertexFormat::Float32x4:
+    case VertexFormat::Uint32x4:
+    case VertexFormat::Sint32x4:
+      return 16;
+  }
+  throw std::invalid_argument{"Unknown vertex format"};
+}
+
+VertexFormat vertexFormat(std::string_view type) {
+  std::string compact;
+  for (char c : type) {
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+      compact += c;
+    }
+  }
+
+  // vecN<T> and the vecNT shorthands
+  int components = 1;
+  std::string scalar = compact;
+  if (compact.size() >= 5 && compact.starts_with("vec") &&
+      compact[3] >= '2' && compact[3] <= '4') {
+    components = compact[3] - '0';
+    if (compact.size() == 5) {
+      static const std::unordered_map<char, std::string> shorthands = {
+          {'f', "f32"}, {'h', "f16"}, {'i', "i32"}, {'u', "u32"}};
+      auto it = shorthands.find(compact[4]);
+      scalar = it != shorthands.end() ? it->second : "";
+    } else if (compact[4] == '<' && compact.back() == '>') {
+      scalar = compact.substr(5, compact.size() - 6);
+    } else {
+      scalar = "";
+    }
+  }
+
+  static const VertexFormat f32[] = {
+      VertexFormat::Float32, VertexFormat::Float32x2, VertexFormat::Float32x3,
+      VertexFormat::Float32x4};
+  static const VertexFormat u32[] = {VertexFormat::Uint32,
+                                     VertexFormat::Uint32x2,
+                                     VertexFormat::Uint32x3,
+                                     VertexFormat::Uint32x4};
+  static const VertexFormat i32[] = {VertexFormat::Sint32,
+                                     VertexFormat::Sint32x2,
+                                     VertexFormat::Sint32x3,
+                                     VertexFormat::Sint32x4};
+
+  if (scalar == "f32") {
+    return f32[components - 1];
+  } else if (scalar == "u32") {
+    return u32[components - 1];
+  } else if (scalar == "i32") {
+    return i32[components - 1];
+  } else if (scalar == "f16" && components == 2) {
+    return VertexFormat::Float16x2;
+  } else if (scalar == "f16" && components == 4) {
+    return VertexFormat::Float16x4;
+  }
+  throw std::domain_error{"Type " + std::string{type} +
+                          " is not a valid vertex input"};
+}
+
+std::vector<VertexBufferLayout> vertexBufferLayouts(
+    const Function& entry,
+    const std::unordered_map<uint32_t, uint32_t>& locationToBuffer) {
+  struct Located {
+    uint32_t location;
+    uint32_t buffer;
+    VertexFormat format;
+  };
+  std::vector<Located> inputs;
+  for (const auto& input : entry.inputs) {
+    if (std::none_of(input.attributes.begin(), input.attributes.end(),
+                     [](const auto& a) { return a.name == "location"; })) {
+      // builtins do not come from vertex buffers
+      continue;
+    }
+    if (!input.location) {
+      throw std::domain_error{"Location of " + input.name +
+                              " could not be evaluated"};
+    }
+    auto buffer = locationToBuffer.find(*input.location);
+    inputs.push_back(Located{
+        *input.location,
+        buffer != locationToBuffer.end() ? buffer->second : 0,
+        vertexFormat(input.type)});
+  }
+  std::sort(inputs.begin(), inputs.end(), [](const auto& a, const auto& b) {
+    return a.location < b.location;
+  });
+
+  std::vector<VertexBufferLayout> layouts;
+  for (const auto& input : inputs) {
+    if (input.buffer >= layouts.size()) {
+      layouts.resize(input.buffer + 1);
+    }
+    auto& layout = layouts[input.buffer];
+    layout.attributes.push_back(
+        VertexAttribute{input.format, layout.arrayStride, input.location});
+    layout.arrayStride += formatSize(input.format);
+  }
+  return layouts;
+}
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const VertexBufferLayout& layout) {
+  j["arrayStride"] = layout.arrayStride;
+  j["attributes"] = BasicJson::array();
+  for (const auto& attribute : layout.attributes) {
+    BasicJson a;
+    a["format"] = formatName(attribute.format);
+    a["offset"] = attribute.offset;
+    a["shaderLocation"] = attribute.shaderLocation;
+    j["attributes"].push_back(std::move(a));
+  }
+}
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const BindGroupLayout& layout) {
+  char hash[17];
+  std::snprintf(hash, sizeof(hash), "%016llx",
+                static_cast<unsigned long long>(layout.hash()));
+  j["hash"] = hash;
+  j["entries"] = BasicJson::array();
+  for (const auto& entry : layout.entries()) {
+    BasicJson e;
+    e["binding"] = entry.binding;
+    e["resource"] = entry.resource;
+    e["visibility"] = entry.visibility;
+    if (!entry.sampleType.empty()) {
+      e["sampleType"] = entry.sampleType;
+    }
+    if (!entry.viewDimension.empty()) {
+      e["viewDimension"] = entry.viewDimension;
+    }
+    if (entry.multisampled) {
+      e["multisampled"] = true;
+    }
+    if (!entry.format.empty()) {
+      e["format"] = entry.format;
+      e["access"] = entry.access;
+    }
+    j["entries"].push_back(std::move(e));
+  }
+}
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const GroupLayout& layout) {
+  j["group"] = layout.group;
+  to_json(j, layout.layout);
+}
+
+template void to_json(nlohmann::json&, const BindGroupLayout&);
+template void to_json(nlohmann::ordered_json&, const BindGroupLayout&);
+template void to_json(nlohmann::json&, const GroupLayout&);
+template void to_json(nlohmann::ordered_json&, const GroupLayout&);
+template void to_json(nlohmann::json&, const VertexBufferLayout&);
+template void to_json(nlohmann::ordered_json&, const VertexBufferLayout&);
+
+}  // namespace wgsl_reflect
@@ -1,27 +1,152 @@
+#include "wgsl_reflect/callgraph.hpp"
+#include "wgsl_reflect/embedded.hpp"
+#include "wgsl_reflect/minify.hpp"
 #include "wgsl_reflect/reflect.hpp"
+#include "wgsl_reflect/server.hpp"
 
 #include <CLI/App.hpp>
 #include <CLI/Config.hpp>
 #include <CLI/Formatter.hpp>
 #include <nlohmann/json.hpp>
 
+#include <chrono>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 
 int main(int argc, char** argv) {
   CLI::App app{"App description"};
 
   std::filesystem::path filename;
-  app.add_option("file", filename, "The .wgsl file to process")->required();
+  auto file_opt =
+      app.add_option("file", filename, "The .wgsl file to process");
+
+  wgsl_reflect::Reflect::Options options;
+  app.add_option("-j,--threads", options.threads,
+                 "Threads extracting declarations, 0 for all cores");
+
+  auto bindings_only_opt = app.add_flag(
+      "--bindings-only", options.bindingsOnly,
+      "Only reflect bind groups, without parsing function bodies");
+
+  size_t timeout_ms = 0;
+  app.add_option("--timeout", timeout_ms,
+                 "Time budget per reflection in milliseconds, 0 for none");
+
+  std::string strip;
+  app.add_option("--strip", strip,
+                 "Print the source reduced to what this entry point uses "
+                 "instead of the reflection")
+      ->excludes(bindings_only_opt);
+
+  bool minify = false;
+  app.add_flag("--minify", minify,
+               "Add minified source to the reflection output")
+      ->excludes(bindings_only_opt);
+
+  // renames are part of the output
+  wgsl_reflect::MinifyOptions minifyOptions;
+  app.add_flag("--minify-entry-points", minifyOptions.renameEntryPoints,
+               "Also rename entry points when minifying");
+  app.add_flag("--minify-bindings", minifyOptions.renameBindings,
+               "Also rename bindings when minifying");
+  app.add_flag("--minify-inputs", minifyOptions.renameInputs,
+               "Also rename the @location and @builtin parameters of entry "
+               "points when minifying");
+
+  std::vector<std::filesystem::path> hosts;
+  app.add_option("--embedded", hosts,
+                 "Reflect the WGSL embedded in these C++, JavaScript and "
+                 "Markdown files in place, with locations in the files")
+      ->excludes(file_opt);
+
+  bool server = false;
+  app.add_flag("--server", server,
+               "Serve line delimited JSON-RPC requests on stdin/stdout")
+      ->excludes(file_opt);
 
   CLI11_PARSE(app, argc, argv);
 
-  wgsl_reflect::Reflect reflect{filename};
+  options.timeout = std::chrono::milliseconds{timeout_ms};
+
+  if (server) {
+    wgsl_reflect::Server{options}.run(std::cin, std::cout);
+    return 0;
+  }
+
+  if (!hosts.empty()) {
+    // one entry per file and region, failures are reported in place
+    nlohmann::ordered_json j = nlohmann::ordered_json::object();
+    bool failed = false;
+    for (const auto& host : hosts) {
+      auto& regions = j[host.string()] = nlohmann::ordered_json::array();
+      auto language = wgsl_reflect::hostLanguage(host);
+      if (!language) {
+        std::cerr << host << ": unknown host language" << std::endl;
+        failed = true;
+        continue;
+      }
+      std::ifstream ifs{host};
+      if (!ifs) {
+        std::cerr << host << ": cannot be read" << std::endl;
+        failed = true;
+        continue;
+      }
+      std::stringstream ss;
+      ss << ifs.rdbuf();
+      // the regions share one copy of the host
+      auto source = std::make_shared<const std::string>(ss.str());
+      for (auto range : wgsl_reflect::findEmbeddedWgsl(*source, *language)) {
+        nlohmann::ordered_json region;
+        region["location"] = wgsl_reflect::locate(*source, range.start);
+        try {
+          region["reflection"] = wgsl_reflect::Reflect{source, range, options};
+        } catch (const std::exception& e) {
+          region["error"] = e.what();
+          failed = true;
+        }
+        regions.push_back(std::move(region));
+      }
+    }
+    std::cout << j.dump(2) << std::endl;
+    return failed ? 1 : 0;
+  }
+
+  if (filename.empty()) {
+    std::cerr << "A .wgsl file to process is required" << std::endl;
+    return 1;
+  }
+
+  std::optional<wgsl_reflect::Reflect> reflect;
+  try {
+    reflect.emplace(filename, options);
+  } catch (const wgsl_reflect::ReflectAborted& e) {
+    std::cerr << filename << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  if (!strip.empty()) {
+    try {
+      std::cout << wgsl_reflect::CallGraph{*reflect}.strip(strip);
+    } catch (const std::out_of_range& e) {
+      std::cerr << filename << ": " << e.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
 
   std::cout << filename << std::endl;
 
-  nlohmann::json j;
-  j = reflect;
+  nlohmann::ordered_json j;
+  j = *reflect;
+  if (minify) {
+    j["minified"] = wgsl_reflect::Minifier{minifyOptions}.minify(*reflect);
+  }
 
   std::cout << j.dump(2) << std::endl;
 
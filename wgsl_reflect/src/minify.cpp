@@ -0,0 +1,348 @@
+#include "wgsl_reflect/minify.hpp"
+
+#include "cppts/tree.hpp"
+#include "wgsl_reflect/ast.hpp"
+#include "wgsl_reflect/callgraph.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace wgsl_reflect {
+
+namespace {
+/// How an identifier is used
+enum class Role {
+  Reference,
+  /// Inside a type, e.g. a struct name or a texel format
+  Type,
+  /// Name of a variable, constant or parameter
+  Declaration,
+  /// Struct member, declared or accessed
+  Member,
+  /// Inside attributes and address space qualifiers, never renamed
+  Fixed,
+};
+
+struct Context {
+  bool fixed{false};
+  bool structMember{false};
+  bool type{false};
+};
+
+/// Call `visit(token, role)` for every token below `node` in source order,
+/// comments excluded. `role` is only meaningful for identifiers.
+template <typename Visit>
+void walk(cppts::Node node, Context context, Visit& visit) {
+  if (node.is(ast::symbol::attribute) ||
+      node.is(ast::symbol::variable_qualifier)) {
+    context.fixed = true;
+  }
+  if (node.is(ast::symbol::struct_member)) {
+    context.structMember = true;
+  }
+  if (node.is(ast::symbol::type_declaration)) {
+    context.type = true;
+  }
+
+  std::optional<cppts::Node> name;
+  if (auto decl = ast::VariableIdentifierDeclaration::cast(node); decl) {
+    name = decl->name().node();
+  }
+
+  std::string_view previous;
+  bool afterQualifier = false;
+  for (auto child : node.children()) {
+    if (child.isExtra()) {
+      continue;
+    }
+    if (child.childCount() > 0) {
+      walk(child, context, visit);
+    } else {
+      Role role = Role::Reference;
+      if (context.fixed) {
+        role = Role::Fixed;
+      } else if (previous == ".") {
+        role = Role::Member;
+      } else if (name && child == *name) {
+        role = context.structMember ? Role::Member : Role::Declaration;
+      } else if (previous == "let" || previous == "const" ||
+                 previous == "var" || previous == "override" ||
+                 afterQualifier) {
+        role = Role::Declaration;
+      } else if (context.type) {
+        role = Role::Type;
+      }
+      visit(child, role);
+    }
+    previous = child.str();
+    afterQualifier = child.is(ast::symbol::variable_qualifier);
+  }
+}
+
+bool isWordChar(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isOperatorChar(char c) {
+  return std::string_view{"+-*/%&|^<>=!"}.find(c) != std::string_view::npos;
+}
+
+/// WGSL keywords, reserved words and predeclared names that generated names
+/// must not take
+bool reserved(std::string_view name) {
+  static const std::unordered_set<std::string_view> words = {
+      "abstract", "active",   "alias",     "alignas",   "alignof",
+      "array",    "as",       "asm",       "async",     "atomic",
+      "attribute", "auto",    "await",     "become",    "bool",
+      "break",    "case",     "cast",      "catch",     "class",
+      "coherent", "common",   "compile",   "concept",   "const",
+      "continue", "continuing", "crate",   "debugger",  "decltype",
+      "default",  "delete",   "demote",    "diagnostic", "discard",
+      "do",       "else",     "enable",    "enum",      "explicit",
+      "export",   "extends",  "extern",    "external",  "false",
+      "filter",   "final",    "finally",   "fn",        "for",
+      "friend",   "from",     "fxgroup",   "get",       "goto",
+      "highp",    "if",       "impl",      "import",    "inline",
+      "layout",   "let",      "loop",      "lowp",      "macro",
+      "match",    "mediump",  "meta",      "mod",       "module",
+      "move",     "mut",      "mutable",   "new",       "nil",
+      "noinline", "null",     "nullptr",   "of",        "operator",
+      "override", "package",  "pass",      "patch",     "precise",
+      "priv",     "ptr",      "pub",       "public",    "ref",
+      "register", "require",  "requires",  "resource",  "restrict",
+      "return",   "sampler",  "self",      "set",       "shared",
+      "sizeof",   "smooth",   "snorm",     "static",    "std",
+      "struct",   "super",    "switch",    "target",    "template",
+      "this",     "throw",    "trait",     "true",      "try",
+      "type",     "typedef",  "typeid",    "typename",  "typeof",
+      "union",    "unless",   "unorm",     "unsafe",    "unsized",
+      "use",      "using",    "var",       "varying",   "virtual",
+      "volatile", "wgsl",     "where",     "while",     "with",
+      "yield"};
+  return words.count(name) > 0;
+}
+
+/// Short names in the order a, b, ..., z, aa, ab, ..., skipping `taken`
+class NameGenerator {
+ public:
+  explicit NameGenerator(const std::unordered_set<std::string>& taken)
+      : m_taken{&taken} {}
+
+  std::string next() {
+    while (true) {
+      std::string name;
+      for (size_t n = ++m_counter; n > 0; n = (n - 1) / 26) {
+        name.insert(name.begin(), static_cast<char>('a' + (n - 1) % 26));
+      }
+      if (m_taken->count(name) == 0 && !reserved(name)) {
+        return name;
+      }
+    }
+  }
+
+ private:
+  const std::unordered_set<std::string>* m_taken;
+  size_t m_counter{0};
+};
+
+struct FunctionScope {
+  std::string name;
+  bool entry{false};
+  /// Parameters and locals in order of declaration
+  std::vector<std::string> locals;
+  /// @location and @builtin parameters
+  std::unordered_set<std::string> inputs;
+  std::unordered_map<std::string, std::string> renames;
+};
+}  // namespace
+
+Minified Minifier::minify(const Reflect& reflect) const {
+  if (!reflect.m_tree) {
+    throw std::logic_error{"Minifying needs a reflection parsed from source"};
+  }
+  CallGraph graph{reflect};
+  auto root = reflect.m_tree->rootNode();
+
+  std::unordered_set<std::string> taken;
+  std::unordered_set<std::string> typeNames;
+  auto collect = [&](cppts::Node token, Role role) {
+    if (token.is(ast::symbol::identifier)) {
+      taken.emplace(token.str());
+      if (role == Role::Type) {
+        typeNames.emplace(token.str());
+      }
+    }
+  };
+  walk(root, Context{}, collect);
+
+  std::unordered_set<std::string> entries;
+  for (const auto* stage : {&reflect.entries().vertex,
+                            &reflect.entries().fragment,
+                            &reflect.entries().compute}) {
+    for (size_t index : *stage) {
+      entries.insert(reflect.functions()[index].name);
+    }
+  }
+  std::unordered_set<std::string> bindings;
+  for (const auto& group : reflect.bindGroups()) {
+    for (const auto& binding : group.bindings()) {
+      bindings.insert(binding.name);
+    }
+  }
+
+  // parameters and locals of every function, by top level declaration
+  std::unordered_map<uint32_t, FunctionScope> scopes;
+  std::unordered_set<std::string> allLocals;
+  for (auto decl : root.namedChildren()) {
+    auto function = ast::FunctionDeclaration::cast(decl);
+    if (!function) {
+      continue;
+    }
+    FunctionScope scope;
+    scope.name = function->name().str();
+    scope.entry = entries.count(scope.name) > 0;
+    auto declare = [&](cppts::Node token, Role role) {
+      if (role == Role::Declaration &&
+          std::find(scope.locals.begin(), scope.locals.end(), token.str()) ==
+              scope.locals.end()) {
+        scope.locals.emplace_back(token.str());
+        allLocals.emplace(token.str());
+      }
+    };
+    walk(decl, Context{}, declare);
+
+    if (auto parameters = function->parameterList(); parameters) {
+      for (auto parameter : parameters->parameters()) {
+        bool input = false;
+        std::optional<std::string> name;
+        for (auto child : parameter.node().namedChildren()) {
+          if (child.is(ast::symbol::attribute)) {
+            auto attribute = child.namedChild(0).str();
+            input |= attribute == "location" || attribute == "builtin";
+          } else if (auto idecl =
+                         ast::VariableIdentifierDeclaration::cast(child)) {
+            name = idecl->name().str();
+          }
+        }
+        if (input && name) {
+          scope.inputs.insert(*name);
+        }
+      }
+    }
+    scopes.emplace(decl.start(), std::move(scope));
+  }
+
+  // module scope names, unless a local somewhere has the same name
+  Minified result;
+  std::unordered_set<std::string> moduleNames;
+  std::unordered_map<std::string, std::string> globals;
+  NameGenerator globalNames{taken};
+  for (const auto& decl : graph.declarations()) {
+    moduleNames.insert(decl.name);
+  }
+  for (const auto& decl : graph.declarations()) {
+    bool rename = false;
+    std::map<std::string, std::string>* mapping = nullptr;
+    if (decl.kind == DeclarationKind::Function) {
+      bool entry = entries.count(decl.name) > 0;
+      rename = !entry || m_options.renameEntryPoints;
+      mapping = entry ? &result.entryPoints : nullptr;
+    } else if (decl.kind == DeclarationKind::Structure) {
+      rename = true;
+    } else if (decl.kind == DeclarationKind::Variable &&
+               bindings.count(decl.name) > 0) {
+      rename = m_options.renameBindings;
+      mapping = &result.bindings;
+    }
+    if (!rename || allLocals.count(decl.name) > 0 ||
+        (decl.kind != DeclarationKind::Structure &&
+         typeNames.count(decl.name) > 0) ||
+        globals.count(decl.name) > 0) {
+      continue;
+    }
+    auto name = globalNames.next();
+    taken.insert(name);
+    globals.emplace(decl.name, name);
+    if (mapping != nullptr) {
+      mapping->emplace(decl.name, name);
+    }
+  }
+
+  for (auto& [_, scope] : scopes) {
+    NameGenerator localNames{taken};
+    for (const auto& local : scope.locals) {
+      bool input = scope.entry && scope.inputs.count(local) > 0;
+      if (moduleNames.count(local) > 0 || typeNames.count(local) > 0 ||
+          (input && !m_options.renameInputs)) {
+        continue;
+      }
+      auto name = localNames.next();
+      scope.renames.emplace(local, name);
+      if (input) {
+        result.inputs[scope.name].emplace(local, name);
+      }
+    }
+  }
+
+  const FunctionScope* scope = nullptr;
+  auto emit = [&](cppts::Node token, Role role) {
+    std::string_view text = token.str();
+    if (text.empty()) {
+      return;
+    }
+    if (token.is(ast::symbol::identifier) && role != Role::Fixed &&
+        role != Role::Member) {
+      std::string key{text};
+      if (scope != nullptr && scope->renames.count(key) > 0) {
+        text = scope->renames.at(key);
+      } else if (auto global = globals.find(key); global != globals.end()) {
+        text = global->second;
+      }
+    }
+    if (!result.source.empty()) {
+      char last = result.source.back();
+      if ((isWordChar(last) && isWordChar(text.front())) ||
+          (isOperatorChar(last) && isOperatorChar(text.front()))) {
+        result.source += ' ';
+      }
+    }
+    result.source += text;
+  };
+
+  for (auto decl : root.children()) {
+    if (decl.isExtra()) {
+      continue;
+    }
+    auto it = scopes.find(decl.start());
+    scope = it != scopes.end() && decl.is(ast::symbol::function_declaration)
+                ? &it->second
+                : nullptr;
+    if (decl.childCount() == 0) {
+      emit(decl, Role::Reference);
+    } else {
+      walk(decl, Context{}, emit);
+    }
+  }
+  return result;
+}
+
+template <typename BasicJson>
+void to_json(BasicJson& j, const Minified& minified) {
+  j["source"] = minified.source;
+  j["entryPoints"] = minified.entryPoints;
+  j["bindings"] = minified.bindings;
+  j["inputs"] = minified.inputs;
+}
+
+template void to_json(nlohmann::json&, const Minified&);
+template void to_json(nlohmann::ordered_json&, const Minified&);
+
+}  // namespace wgsl_reflect
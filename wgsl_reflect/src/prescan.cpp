@@ -0,0 +1,172 @@
+#include "prescan.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WGSL_REFLECT_SSE2 1
+#endif
+
+namespace wgsl_reflect::detail {
+
+namespace {
+bool isSpecial(char c) {
+  return c == '/' || c == '{' || c == '}' || c == '@' || c == ';';
+}
+
+/// Position of the next character that can change the scanner state, or
+/// the size of `source`. Most of a shader is function bodies and
+/// declarations without any of them, so 16 bytes are tested at a time.
+size_t nextSpecial(std::string_view source, size_t pos) {
+#ifdef WGSL_REFLECT_SSE2
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+  const __m128i at = _mm_set1_epi8('@');
+  const __m128i semicolon = _mm_set1_epi8(';');
+  while (pos + 16 <= source.size()) {
+    __m128i chunk = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(source.data() + pos));
+    __m128i hits = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, slash), _mm_cmpeq_epi8(chunk, open)),
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, close),
+                         _mm_cmpeq_epi8(chunk, at)),
+            _mm_cmpeq_epi8(chunk, semicolon)));
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+    if (mask != 0) {
+      return pos + std::countr_zero(mask);
+    }
+    pos += 16;
+  }
+#endif
+  while (pos < source.size() && !isSpecial(source[pos])) {
+    pos++;
+  }
+  return pos;
+}
+
+/// Position after the block comment starting at `pos`. Block comments nest.
+size_t skipBlockComment(std::string_view source, size_t pos) {
+  int depth = 0;
+  while (pos + 1 < source.size()) {
+    if (source[pos] == '/' && source[pos + 1] == '*') {
+      depth++;
+      pos += 2;
+    } else if (source[pos] == '*' && source[pos + 1] == '/') {
+      depth--;
+      pos += 2;
+      if (depth == 0) {
+        return pos;
+      }
+    } else {
+      pos++;
+    }
+  }
+  return source.size();
+}
+
+bool isIdentifierChar(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+/// Whether `declaration` is a constant or override, which binding numbers
+/// may refer to. Comments and attributes in front of it are skipped.
+bool declaresConstant(std::string_view declaration) {
+  size_t pos = 0;
+  while (pos < declaration.size()) {
+    char c = declaration[pos];
+    char next = pos + 1 < declaration.size() ? declaration[pos + 1] : '\0';
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      pos++;
+    } else if (c == '/' && next == '/') {
+      pos = std::min(declaration.find('\n', pos), declaration.size());
+    } else if (c == '/' && next == '*') {
+      pos = skipBlockComment(declaration, pos);
+    } else if (c == '@') {
+      // the attribute name and its arguments, like @id(0)
+      pos++;
+      while (pos < declaration.size() && isIdentifierChar(declaration[pos])) {
+        pos++;
+      }
+      size_t open = declaration.find_first_not_of(" \t\r\n", pos);
+      if (open != std::string_view::npos && declaration[open] == '(') {
+        pos = std::min(declaration.find(')', open), declaration.size());
+        pos++;
+      }
+    } else {
+      break;
+    }
+  }
+  size_t end = pos;
+  while (end < declaration.size() && isIdentifierChar(declaration[end])) {
+    end++;
+  }
+  auto keyword = declaration.substr(pos, end - pos);
+  return keyword == "const" || keyword == "override" || keyword == "let";
+}
+}  // namespace
+
+std::vector<SourceRange> scanBindingDeclarations(std::string_view source) {
+  std::vector<SourceRange> result;
+  size_t start = 0;
+  size_t depth = 0;
+  bool binding = false;
+
+  auto endDeclaration = [&](size_t end) {
+    if (binding || declaresConstant(source.substr(start, end - start))) {
+      result.push_back(SourceRange{start, end});
+    }
+    start = end;
+    binding = false;
+  };
+
+  size_t pos = 0;
+  while ((pos = nextSpecial(source, pos)) < source.size()) {
+    char c = source[pos];
+    char next = pos + 1 < source.size() ? source[pos + 1] : '\0';
+    if (c == '/' && next == '/') {
+      pos = source.find('\n', pos);
+      if (pos == std::string_view::npos) {
+        break;
+      }
+      continue;
+    }
+    if (c == '/' && next == '*') {
+      pos = skipBlockComment(source, pos);
+      continue;
+    }
+
+    if (c == '{') {
+      depth++;
+    } else if (c == '}') {
+      // unbalanced braces are left to the parser
+      depth = depth > 0 ? depth - 1 : 0;
+      if (depth == 0) {
+        endDeclaration(pos + 1);
+      }
+    } else if (c == ';' && depth == 0) {
+      endDeclaration(pos + 1);
+    } else if (c == '@' && depth == 0) {
+      size_t name = pos + 1;
+      while (name < source.size() &&
+             std::isspace(static_cast<unsigned char>(source[name]))) {
+        name++;
+      }
+      size_t end = name;
+      while (end < source.size() && isIdentifierChar(source[end])) {
+        end++;
+      }
+      auto attribute = source.substr(name, end - name);
+      binding |= attribute == "group" || attribute == "binding";
+    }
+    pos++;
+  }
+  endDeclaration(source.size());
+  return result;
+}
+
+}  // namespace wgsl_reflect::detail
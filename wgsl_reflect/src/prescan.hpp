@@ -0,0 +1,17 @@
+#pragma once
+
+#include "wgsl_reflect/reflect.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace wgsl_reflect::detail {
+
+/// Byte ranges of the top level declarations of `source` that carry @group
+/// or @binding attributes, and of the constants and overrides their values
+/// may refer to, found without parsing. Comments and everything inside
+/// braces are skipped. A range may start with the whitespace and comments
+/// in front of its declaration.
+std::vector<SourceRange> scanBindingDeclarations(std::string_view source);
+
+}  // namespace wgsl_reflect::detail
@@ -2,151 +2,966 @@
 
 #include "cppts/parser.hpp"
 #include "cppts/tree.hpp"
+#include "wgsl_reflect/ast.hpp"
+#include "wgsl_reflect/layout.hpp"
+#include "evaluate.hpp"
+#include "hash.hpp"
+#include "prescan.hpp"
 #include <tree_sitter_wgsl.h>
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <charconv>
+#include <cstdio>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <mutex>
 #include <regex>
 #include <sstream>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
 
 using namespace std::string_literals;
+using namespace std::string_view_literals;
 using namespace nlohmann;
 
 namespace wgsl_reflect {
-Reflect::Reflect(const std::filesystem::path& source_file) {
+
+namespace detail {
+/// Parser of a reflection and its variants. Variants of the same base may
+/// be built concurrently, so they parse under the lock.
+struct SharedParser {
+  cppts::Parser parser{tree_sitter_wgsl()};
+  std::mutex mutex;
+};
+}  // namespace detail
+
+namespace {
+std::string_view attributeName(const ast::Attribute& attribute) {
+  return attribute.node().namedChild(0).str();
+}
+
+/// Queries of the extraction passes, compiled once with their capture
+/// handles resolved.
+struct Queries {
+  std::shared_ptr<cppts::Query> structs = cppts::Query::create(
+      tree_sitter_wgsl(), "(struct_declaration) @thestruct");
+  cppts::CaptureHandle thestruct = structs->capture("thestruct");
+
+  std::shared_ptr<cppts::Query> functions = cppts::Query::create(
+      tree_sitter_wgsl(), "(function_declaration) @thefunc");
+  cppts::CaptureHandle thefunc = functions->capture("thefunc");
+
+  // only globals with a @group attribute are resource bindings. The anchor
+  // matches the attribute's name, not identifiers in its arguments.
+  std::shared_ptr<cppts::Query> globals = cppts::Query::create(
+      tree_sitter_wgsl(),
+      "((global_variable_declaration (attribute . (identifier) @attr)) "
+      "@thegroup (#eq? @attr \"group\"))");
+  cppts::CaptureHandle thegroup = globals->capture("thegroup");
+};
+
+const Queries& queries() {
+  static const Queries q;
+  return q;
+}
+
+constexpr std::pair<std::string_view, Builtin> builtins[] = {
+    {"vertex_index", Builtin::VertexIndex},
+    {"instance_index", Builtin::InstanceIndex},
+    {"position", Builtin::Position},
+    {"front_facing", Builtin::FrontFacing},
+    {"frag_depth", Builtin::FragDepth},
+    {"sample_index", Builtin::SampleIndex},
+    {"sample_mask", Builtin::SampleMask},
+    {"local_invocation_id", Builtin::LocalInvocationId},
+    {"local_invocation_index", Builtin::LocalInvocationIndex},
+    {"global_invocation_id", Builtin::GlobalInvocationId},
+    {"workgroup_id", Builtin::WorkgroupId},
+    {"num_workgroups", Builtin::NumWorkgroups},
+    {"subgroup_invocation_id", Builtin::SubgroupInvocationId},
+    {"subgroup_size", Builtin::SubgroupSize},
+};
+
+/// Non-negative 32 bit value of a constant expression
+std::optional<uint32_t> evaluateIndex(std::string_view expression,
+                                      const detail::Constants& constants) {
+  auto value = detail::evaluate(expression, constants);
+  if (!value || *value < 0 || *value > std::numeric_limits<uint32_t>::max()) {
+    return std::nullopt;
+  }
+  return static_cast<uint32_t>(*value);
+}
+
+std::optional<std::array<uint32_t, 3>> evaluateWorkgroupSize(
+    std::string_view arguments, const detail::Constants& constants) {
+  auto dimensions = detail::splitArguments(arguments);
+  if (dimensions.size() > 3) {
+    return std::nullopt;
+  }
+  std::array<uint32_t, 3> size{1, 1, 1};
+  for (size_t i = 0; i < dimensions.size(); i++) {
+    auto value = evaluateIndex(dimensions[i], constants);
+    if (!value) {
+      return std::nullopt;
+    }
+    size[i] = *value;
+  }
+  return size;
+}
+
+std::optional<uint32_t> evaluatedLocation(const Input& input,
+                                          const detail::Constants& constants) {
+  std::optional<uint32_t> location = input.location;
+  for (const auto& attribute : input.attributes) {
+    if (attribute.name == "location") {
+      location = evaluateIndex(attribute.value, constants);
+    }
+  }
+  return location;
+}
+
+void evaluateLocation(Input& input, const detail::Constants& constants) {
+  input.location = evaluatedLocation(input, constants);
+}
+}  // namespace
+
+std::string_view builtinName(Builtin builtin) {
+  for (const auto& [name, value] : builtins) {
+    if (value == builtin) {
+      return name;
+    }
+  }
+  throw std::invalid_argument{"Unknown builtin"};
+}
+
+Reflect::Reflect(const std::filesystem::path& source_file,
+                 const Options& options) {
   std::stringstream ss;
   std::ifstream ifs{source_file};
   ifs.exceptions(std::ifstream::failbit);
   ss << ifs.rdbuf();
-  m_source = ss.str();
-  initialize();
+  m_source = std::make_shared<const std::string>(ss.str());
+  initialize(options);
 }
 
-Reflect::Reflect(const std::string& source) : m_source{source} { initialize(); }
+Reflect::Reflect(const std::string& source, const Options& options)
+    : m_source{std::make_shared<const std::string>(source)} {
+  initialize(options);
+}
 
-void Reflect::initialize() {
-  m_parser = std::make_unique<cppts::Parser>(tree_sitter_wgsl());
-  m_tree = std::make_unique<cppts::Tree>(*m_parser, m_source);
+Reflect::Reflect(const std::string& host, SourceRange range,
+                 const Options& options)
+    : Reflect{std::make_shared<const std::string>(host), range, options} {}
 
-  parseStructures();
-  parseFunctions();
-  parseEntrypoints();
-  parseBindGroups();
+Reflect::Reflect(std::shared_ptr<const std::string> host, SourceRange range,
+                 const Options& options)
+    : m_source{std::move(host)}, m_embedded{range} {
+  if (!m_source || range.start > range.end || range.end > m_source->size()) {
+    throw std::invalid_argument{"Embedded range out of range"};
+  }
+  initialize(options);
+}
+
+namespace {
+SourceLocation locate(cppts::Node node) {
+  auto point = node.startPoint();
+  return SourceLocation{node.start(), point.row, point.column};
+}
+
+/// `record` at `location`, copied only if it moved
+template <typename T>
+std::shared_ptr<const T> relocate(std::shared_ptr<const T> record,
+                                  SourceLocation location) {
+  if (record->location == location) {
+    return record;
+  }
+  auto moved = std::make_shared<T>(*record);
+  moved->location = location;
+  return moved;
+}
+
+/// Split the top level declarations into at most `threads` contiguous
+/// chunks of roughly equal declaration count.
+std::vector<cppts::ByteRange> splitDeclarations(cppts::Tree& tree,
+                                                size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (threads == 1) {
+    return {cppts::ByteRange{}};
+  }
+
+  std::vector<cppts::ByteRange> decls;
+  for (auto decl : tree.rootNode().namedChildren()) {
+    decls.push_back(decl.byteRange());
+  }
+
+  size_t n = std::min(threads, decls.size());
+  std::vector<cppts::ByteRange> chunks;
+  for (size_t i = 0; i < n; i++) {
+    size_t first = i * decls.size() / n;
+    size_t last = (i + 1) * decls.size() / n - 1;
+    chunks.push_back(cppts::ByteRange{decls[first].start, decls[last].end});
+  }
+  return chunks;
 }
 
-void Reflect::parseStructures() {
-  std::string query_string = "(struct_declaration) @thestruct";
+/// Run `extract` on every chunk and concatenate the results in chunk order.
+/// With more than one chunk, each one is processed on its own thread with
+/// its own copy of the tree.
+template <typename T, typename Extract>
+std::vector<T> extractChunks(cppts::Tree& tree,
+                             const std::vector<cppts::ByteRange>& chunks,
+                             Extract extract) {
+  if (chunks.size() == 1) {
+    return extract(tree, chunks.front());
+  }
+
+  std::vector<std::future<std::vector<T>>> futures;
+  for (const auto& chunk : chunks) {
+    futures.push_back(std::async(
+        std::launch::async, [&extract, chunk, local = tree.copy()]() mutable {
+          return extract(local, chunk);
+        }));
+  }
 
-  auto cursor = m_tree->query(query_string);
-  cppts::Match match;
-  while (cursor.nextMatch(match)) {
-    Structure _struct{match["thestruct"].node()};
-    m_structures.emplace(_struct.name, std::move(_struct));
+  std::vector<T> result;
+  for (auto& future : futures) {
+    auto items = future.get();
+    std::move(items.begin(), items.end(), std::back_inserter(result));
   }
+  return result;
 }
+}  // namespace
+
+void Reflect::initialize(const Options& options) {
+  m_cancel = options.cancel;
+  if (options.timeout.count() > 0) {
+    m_deadline = std::chrono::steady_clock::now() + options.timeout;
+  }
 
-void Reflect::parseFunctions() {
-  std::string query_string = "(function_declaration) @thefunc";
+  m_parser = std::make_shared<detail::SharedParser>();
+  auto& parser = m_parser->parser;
+  parser.setTimeout(options.timeout);
+  parser.setCancellationFlag(options.cancel);
+  try {
+    if (options.bindingsOnly) {
+      parseBindingsOnly();
+    } else if (m_embedded) {
+      cppts::ByteRange range{static_cast<uint32_t>(m_embedded->start),
+                             static_cast<uint32_t>(m_embedded->end)};
+      m_tree = std::make_unique<cppts::Tree>(parser, m_source,
+                                             std::span{&range, 1});
+    } else {
+      m_tree = std::make_unique<cppts::Tree>(parser, m_source);
+    }
+  } catch (const cppts::ParseAborted& e) {
+    throw ReflectAborted{e.what()};
+  }
+  // the flag is not guaranteed to outlive this constructor
+  parser.setCancellationFlag(nullptr);
+  parser.setTimeout(std::chrono::microseconds{0});
+  if (!options.bindingsOnly) {
+    auto chunks = splitDeclarations(*m_tree, options.threads);
 
+    parseStructures(chunks);
+    parseFunctions(chunks);
+    parseConstants(*m_tree);
+    evaluateAttributes();
+    parseEntrypoints();
+    parseBindGroups(*m_tree, chunks);
+  }
+  computeFingerprint();
+  if (options.detach) {
+    detach();
+  }
+  // both only apply to this constructor
+  m_cancel = nullptr;
+  m_deadline.reset();
+}
+
+void Reflect::parseStructures(const std::vector<cppts::ByteRange>& chunks) {
+  auto extract = [this](cppts::Tree& tree, cppts::ByteRange range) {
+    const auto& q = queries();
+    auto cursor = q.structs->exec(tree.rootNode());
+    cursor.setByteRange(range);
+    std::vector<Structure> structures;
+    cppts::Match match;
+    while (cursor.nextMatch(match)) {
+      checkAborted();
+      structures.emplace_back(match[q.thestruct].node());
+    }
+    return structures;
+  };
+
+  for (auto& _struct : extractChunks<Structure>(*m_tree, chunks, extract)) {
+    m_structureIndex.emplace(_struct.name, m_structures.size());
+    m_structures.push_back(
+        std::make_shared<const Structure>(std::move(_struct)));
+  }
+}
+
+void Reflect::parseFunctions(const std::vector<cppts::ByteRange>& chunks) {
+  // m_structures is complete and only read from here on
   auto getStruct = [this](const std::string& s) -> std::optional<Structure> {
-    if (auto it = m_structures.find(s); it != m_structures.end()) {
-      return it->second;
+    if (auto it = m_structureIndex.find(s); it != m_structureIndex.end()) {
+      return *m_structures[it->second];
     }
     return std::nullopt;
   };
 
-  auto cursor = m_tree->query(query_string);
-  cppts::Match match;
-  while (cursor.nextMatch(match)) {
-    Function function{match["thefunc"].node(), getStruct};
-    m_functions.emplace(function.name, std::move(function));
+  auto extract = [this, &getStruct](cppts::Tree& tree,
+                                    cppts::ByteRange range) {
+    const auto& q = queries();
+    auto cursor = q.functions->exec(tree.rootNode());
+    cursor.setByteRange(range);
+    std::vector<Function> functions;
+    cppts::Match match;
+    while (cursor.nextMatch(match)) {
+      checkAborted();
+      functions.emplace_back(match[q.thefunc].node(), getStruct);
+    }
+    return functions;
+  };
+
+  for (auto& function : extractChunks<Function>(*m_tree, chunks, extract)) {
+    m_functionIndex.emplace(function.name, m_functions.size());
+    m_functions.push_back(
+        std::make_shared<const Function>(std::move(function)));
   }
 }
 
 void Reflect::parseEntrypoints() {
-  std::string query_string = "(function_declaration) @thefunc";
-  auto cursor = m_tree->query(query_string);
-  cppts::Match match;
-  while (cursor.nextMatch(match)) {
-    auto func = match["thefunc"].node();
-    std::string name{func.child("name").str()};
-    for (auto child : func.namedChildren()) {
-      if (child.type() != "attribute"s) {
+  for (size_t i = 0; i < m_functions.size(); i++) {
+    if (!m_functions[i]->stage) {
+      continue;
+    }
+    switch (*m_functions[i]->stage) {
+      case Stage::Vertex:
+        m_entries.vertex.push_back(i);
+        break;
+      case Stage::Fragment:
+        m_entries.fragment.push_back(i);
+        break;
+      case Stage::Compute:
+        m_entries.compute.push_back(i);
+        break;
+    }
+  }
+}
+
+void Reflect::parseConstants(cppts::Tree& parsed) {
+  // const, override or the older module scope let, with an initializer
+  static const std::regex declaration{
+      R"(^(?:const|override|let)\s+(\w+)\s*(?::[^=;]*)?=\s*([^;]*?)\s*;?\s*$)"};
+  for (auto decl : parsed.rootNode().namedChildren()) {
+    if (decl.isExtra() || decl.is(ast::symbol::function_declaration) ||
+        decl.is(ast::symbol::struct_declaration) ||
+        decl.is(ast::symbol::global_variable_declaration)) {
+      continue;
+    }
+    // skip attributes like the @id of overrides
+    for (auto child : decl.children()) {
+      if (child.is(ast::symbol::attribute)) {
         continue;
       }
+      std::string text{
+          parsed.source().substr(child.start(), decl.end() - child.start())};
+      std::smatch match;
+      if (std::regex_match(text, match, declaration)) {
+        m_constants.emplace(match[1].str(), match[2].str());
+      }
+      break;
+    }
+  }
+}
+
+void Reflect::evaluateAttributes() {
+  // records may be shared, so the ones that change are copied
+  auto changes = [this](const std::vector<Input>& inputs) {
+    return std::any_of(inputs.begin(), inputs.end(), [this](const auto& input) {
+      return evaluatedLocation(input, m_constants) != input.location;
+    });
+  };
+  auto evaluate = [this](std::vector<Input>& inputs) {
+    for (auto& input : inputs) {
+      evaluateLocation(input, m_constants);
+    }
+  };
+
+  for (auto& structure : m_structures) {
+    if (changes(structure->members)) {
+      auto evaluated = std::make_shared<Structure>(*structure);
+      evaluate(evaluated->members);
+      structure = std::move(evaluated);
+    }
+  }
+  for (auto& function : m_functions) {
+    auto workgroupSize = function->workgroupSize;
+    if (auto size = function->attribute("workgroup_size"); size) {
+      workgroupSize = evaluateWorkgroupSize(*size, m_constants);
+    }
+    if (changes(function->inputs) || changes(function->outputs) ||
+        workgroupSize != function->workgroupSize) {
+      auto evaluated = std::make_shared<Function>(*function);
+      evaluate(evaluated->inputs);
+      evaluate(evaluated->outputs);
+      evaluated->workgroupSize = workgroupSize;
+      function = std::move(evaluated);
+    }
 
-      auto it = m_functions.find(name);
-      if (it == m_functions.end()) {
-        throw std::runtime_error{"Function with name " + name + " not found"};
+    if (function->stage != Stage::Vertex) {
+      continue;
+    }
+    std::optional<std::vector<VertexBufferLayout>> vertexBuffers;
+    try {
+      vertexBuffers = vertexBufferLayouts(*function);
+    } catch (const std::domain_error&) {
+      // left unset, the inputs do not map to vertex attributes
+    }
+    if (vertexBuffers != function->vertexBuffers) {
+      auto evaluated = std::make_shared<Function>(*function);
+      evaluated->vertexBuffers = std::move(vertexBuffers);
+      function = std::move(evaluated);
+    }
+  }
+}
+
+void Reflect::parseBindGroups(cppts::Tree& parsed,
+                              const std::vector<cppts::ByteRange>& chunks) {
+  auto extract = [this](cppts::Tree& tree, cppts::ByteRange range) {
+    const auto& q = queries();
+    auto cursor = q.globals->exec(tree.rootNode());
+    cursor.setByteRange(range);
+    std::vector<Binding> bindings;
+    cppts::Match match;
+    while (cursor.nextMatch(match)) {
+      checkAborted();
+      bindings.emplace_back(match[q.thegroup].node(), m_constants);
+    }
+    return bindings;
+  };
+
+  setBindings(extractChunks<Binding>(parsed, chunks, extract));
+}
+
+void Reflect::parseBindingsOnly() {
+  std::string_view source = *m_source;
+  SourceRange window = m_embedded.value_or(SourceRange{0, source.size()});
+  source = source.substr(window.start, window.end - window.start);
+
+  std::vector<cppts::ByteRange> ranges;
+  for (auto range : detail::scanBindingDeclarations(source)) {
+    ranges.push_back(
+        cppts::ByteRange{static_cast<uint32_t>(window.start + range.start),
+                         static_cast<uint32_t>(window.start + range.end)});
+  }
+  if (ranges.empty()) {
+    // no ranges would include everything
+    return;
+  }
+  // parsed in place, so that locations match a full reflection
+  cppts::Tree tree{m_parser->parser, m_source, ranges};
+  parseConstants(tree);
+  parseBindGroups(tree, {cppts::ByteRange{}});
+}
+
+void Reflect::setBindings(std::vector<Binding> bindings) {
+  std::stable_sort(bindings.begin(), bindings.end(),
+                   [](const Binding& a, const Binding& b) {
+                     return std::tie(a.group, a.binding) <
+                            std::tie(b.group, b.binding);
+                   });
+
+  m_bindGroups.clear();
+  m_bindingIndex.clear();
+  for (size_t i = 0; i < bindings.size(); i++) {
+    if (i + 1 < bindings.size() && bindings[i].group == bindings[i + 1].group &&
+        bindings[i].binding == bindings[i + 1].binding) {
+      continue;
+    }
+    if (m_bindGroups.empty() ||
+        m_bindGroups.back().m_group != bindings[i].group) {
+      m_bindGroups.emplace_back().m_group = bindings[i].group;
+    }
+    auto& group = m_bindGroups.back();
+    m_bindingIndex[bindings[i].name] = {m_bindGroups.size() - 1,
+                                        group.m_bindings.size()};
+    group.m_bindings.push_back(std::move(bindings[i]));
+  }
+}
+
+const BindGroup* Reflect::bindGroup(uint32_t group) const {
+  auto it = std::lower_bound(
+      m_bindGroups.begin(), m_bindGroups.end(), group,
+      [](const BindGroup& g, uint32_t value) { return g.group() < value; });
+  if (it == m_bindGroups.end() || it->group() != group) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+const Binding* Reflect::binding(uint32_t group, uint32_t number) const {
+  const BindGroup* bindGroup = this->bindGroup(group);
+  return bindGroup != nullptr ? bindGroup->binding(number) : nullptr;
+}
+
+const Binding* Reflect::binding(const std::string& name) const {
+  auto it = m_bindingIndex.find(name);
+  if (it == m_bindingIndex.end()) {
+    return nullptr;
+  }
+  return &m_bindGroups[it->second.first].m_bindings[it->second.second];
+}
+
+const Binding* BindGroup::binding(uint32_t number) const {
+  auto it = std::lower_bound(
+      m_bindings.begin(), m_bindings.end(), number,
+      [](const Binding& b, uint32_t value) { return b.binding < value; });
+  if (it == m_bindings.end() || it->binding != number) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+void Reflect::checkAborted() const {
+  if (m_cancel != nullptr && m_cancel->load(std::memory_order_relaxed) != 0) {
+    throw ReflectAborted{"Reflection was cancelled"};
+  }
+  if (m_deadline && std::chrono::steady_clock::now() > *m_deadline) {
+    throw ReflectAborted{"Reflection timed out"};
+  }
+}
+
+namespace {
+void hashInputs(detail::Hasher& hasher, const std::vector<Input>& inputs) {
+  hasher.add(inputs.size());
+  for (const auto& input : inputs) {
+    hasher.add(input.name).addType(input.type).add(input.attributes.size());
+    for (const auto& attribute : input.attributes) {
+      hasher.add(attribute.name).add(attribute.value);
+    }
+  }
+}
+
+uint64_t functionFingerprint(const Function& function) {
+  detail::Hasher hasher;
+  hasher.add(function.name).add(function.attributes.size());
+  for (const auto& attribute : function.attributes) {
+    hasher.add(attribute.name).add(attribute.value);
+  }
+  hashInputs(hasher, function.inputs);
+  hasher.add(function.returnType);
+  hashInputs(hasher, function.outputs);
+  return hasher.value();
+}
+}  // namespace
+
+Reflect::Reflect(std::span<const Reflect* const> units) {
+  std::vector<Binding> bindings;
+  for (const Reflect* unit : units) {
+    m_constants.insert(unit->m_constants.begin(), unit->m_constants.end());
+    for (const auto& structure : unit->m_structures) {
+      if (m_structureIndex.emplace(structure->name, m_structures.size())
+              .second) {
+        m_structures.push_back(structure);
       }
+    }
+  }
 
-      std::string type{child.namedChild(0).str()};
-      if (type == "vertex") {
-        m_entries.vertex.emplace_back(it->second);
-      } else if (type == "fragment") {
-        m_entries.fragment.emplace_back(it->second);
-      } else if (type == "compute") {
-        m_entries.compute.emplace_back(it->second);
+  auto isStruct = [this](const Input& item) {
+    return m_structureIndex.count(item.type) > 0;
+  };
+  // replaces struct typed items by the struct's members
+  auto resolve = [this](std::vector<Input>& items) {
+    std::vector<Input> result;
+    for (const auto& item : items) {
+      auto it = m_structureIndex.find(item.type);
+      if (it == m_structureIndex.end()) {
+        result.push_back(item);
+        continue;
       }
+      const auto& members = m_structures[it->second]->members;
+      result.insert(result.end(), members.begin(), members.end());
+    }
+    items = std::move(result);
+  };
+
+  for (const Reflect* unit : units) {
+    for (const auto& function : unit->m_functions) {
+      if (!m_functionIndex.emplace(function->name, m_functions.size())
+               .second) {
+        continue;
+      }
+      // struct inputs and outputs of other units are still unresolved, the
+      // other functions are shared with their unit
+      if (std::none_of(function->inputs.begin(), function->inputs.end(),
+                       isStruct) &&
+          std::none_of(function->outputs.begin(), function->outputs.end(),
+                       isStruct)) {
+        m_functions.push_back(function);
+        continue;
+      }
+      auto composed = std::make_shared<Function>(*function);
+      resolve(composed->inputs);
+      resolve(composed->outputs);
+      composed->fingerprint = functionFingerprint(*composed);
+      m_functions.push_back(std::move(composed));
+    }
+
+    for (const auto& group : unit->m_bindGroups) {
+      bindings.insert(bindings.end(), group.bindings().begin(),
+                      group.bindings().end());
     }
   }
+  setBindings(std::move(bindings));
+
+  evaluateAttributes();
+  parseEntrypoints();
+  computeFingerprint();
+}
+
+Reflect Reflect::variant(std::span<const SourceEdit> edits) const {
+  return Reflect{*this, edits};
 }
 
-void Reflect::parseBindGroups() {
-  auto cursor = m_tree->query("(global_variable_declaration) @thegroup");
-  cppts::Match match;
-  while (cursor.nextMatch(match)) {
-    auto gnode = match["thegroup"].node();
-    Binding binding{gnode};
-    if (binding.group + 1 > m_bindGroups.size()) {
-      m_bindGroups.resize(binding.group + 1, std::nullopt);
+Reflect::Reflect(const Reflect& base, std::span<const SourceEdit> edits) {
+  if (!base.m_tree) {
+    throw std::logic_error{"Variants need a reflection parsed from source"};
+  }
+  if (base.m_embedded) {
+    throw std::logic_error{"Variants of embedded WGSL are not supported"};
+  }
+
+  std::vector<cppts::TextEdit> textEdits;
+  for (const auto& edit : edits) {
+    if (edit.end > base.m_source->size()) {
+      throw std::invalid_argument{"Edit out of range"};
+    }
+    textEdits.push_back(cppts::TextEdit{static_cast<uint32_t>(edit.start),
+                                        static_cast<uint32_t>(edit.end),
+                                        edit.text});
+  }
+
+  // a copy, so variants of the same base can be built concurrently
+  cppts::Tree baseTree = base.m_tree->copy();
+  m_parser = base.m_parser;
+  {
+    std::lock_guard lock{m_parser->mutex};
+    m_tree = std::make_unique<cppts::Tree>(
+        baseTree.edit(m_parser->parser, textEdits));
+  }
+  m_source = m_tree->sharedSource();
+  parseConstants(*m_tree);
+
+  // base records by the text of their declaration. The extraction passes
+  // produce one record per declaration, in source order.
+  std::unordered_map<std::string_view, size_t> baseStructs;
+  std::unordered_map<std::string_view, size_t> baseFunctions;
+  std::unordered_set<std::string> removedStructs;
+  size_t s = 0;
+  size_t f = 0;
+  for (auto decl : baseTree.rootNode().namedChildren()) {
+    if (decl.is(ast::symbol::struct_declaration)) {
+      baseStructs.emplace(decl.str(), s);
+      removedStructs.insert(base.m_structures[s++]->name);
+    } else if (decl.is(ast::symbol::function_declaration)) {
+      baseFunctions.emplace(decl.str(), f++);
     }
+  }
 
-    if (!m_bindGroups[binding.group].has_value()) {
-      m_bindGroups[binding.group] = BindGroup{};
+  std::unordered_set<std::string> changedStructs;
+  std::vector<cppts::Node> functions;
+  std::vector<Binding> bindings;
+  for (auto decl : m_tree->rootNode().namedChildren()) {
+    if (decl.is(ast::symbol::struct_declaration)) {
+      auto it = baseStructs.find(decl.str());
+      std::shared_ptr<const Structure> structure;
+      if (it == baseStructs.end()) {
+        structure = std::make_shared<const Structure>(decl);
+        changedStructs.insert(structure->name);
+      } else {
+        structure = relocate(base.m_structures[it->second], locate(decl));
+        removedStructs.erase(structure->name);
+      }
+      m_structureIndex.emplace(structure->name, m_structures.size());
+      m_structures.push_back(std::move(structure));
+    } else if (decl.is(ast::symbol::function_declaration)) {
+      functions.push_back(decl);
+    } else if (auto global = ast::GlobalVariableDeclaration::cast(decl);
+               global) {
+      for (auto attribute : global->attributes()) {
+        if (attributeName(attribute) == "group") {
+          bindings.emplace_back(decl, m_constants);
+          break;
+        }
+      }
     }
-    auto& group = m_bindGroups[binding.group].value();
-    if (binding.binding + 1 > group.m_bindings.size()) {
-      group.m_bindings.resize(binding.binding + 1, std::nullopt);
+  }
+  changedStructs.merge(removedStructs);
+  setBindings(std::move(bindings));
+
+  auto getStruct = [this](const std::string& name) -> std::optional<Structure> {
+    if (auto it = m_structureIndex.find(name); it != m_structureIndex.end()) {
+      return *m_structures[it->second];
     }
+    return std::nullopt;
+  };
+  // conservatively re-extract functions naming a changed struct anywhere
+  auto mentionsChanged = [&](std::string_view text) {
+    return std::any_of(
+        changedStructs.begin(), changedStructs.end(),
+        [&](const auto& name) { return text.find(name) != text.npos; });
+  };
 
-    group.m_bindings[binding.binding] = std::move(binding);
+  for (auto decl : functions) {
+    auto it = baseFunctions.find(decl.str());
+    if (it != baseFunctions.end() && !mentionsChanged(decl.str())) {
+      m_functions.push_back(
+          relocate(base.m_functions[it->second], locate(decl)));
+    } else {
+      m_functions.push_back(std::make_shared<const Function>(decl, getStruct));
+    }
+    m_functionIndex.emplace(m_functions.back()->name, m_functions.size() - 1);
   }
+
+  evaluateAttributes();
+  parseEntrypoints();
+  computeFingerprint();
+}
+
+void Reflect::computeFingerprint() {
+  detail::Hasher hasher;
+  for (const auto* stage :
+       {&m_entries.vertex, &m_entries.fragment, &m_entries.compute}) {
+    hasher.add(stage->size());
+    for (size_t index : *stage) {
+      hasher.add(m_functions[index]->fingerprint);
+    }
+  }
+
+  hasher.add(m_bindGroups.size());
+  for (const auto& group : m_bindGroups) {
+    hasher.add(group.group()).add(group.size());
+    for (const auto& binding : group.bindings()) {
+      hasher.add(binding.binding)
+          .add(binding.name)
+          .add(binding.bindingType)
+          .addType(binding.type)
+          .add(binding.addressSpace)
+          .add(binding.accessMode)
+          .add(binding.sampleType)
+          .add(binding.viewDimension)
+          .add(binding.multisampled)
+          .add(binding.texelFormat);
+    }
+  }
+
+  hasher.add(m_structures.size());
+  for (const auto& structure : m_structures) {
+    hasher.add(structure->name);
+    hashInputs(hasher, structure->members);
+  }
+
+  m_fingerprint = hasher.value();
+}
+
+const Structure& Reflect::structure(const std::string& name) const {
+  return *m_structures[m_structureIndex.at(name)];
+}
+
+const Function& Reflect::function(const std::string& name) const {
+  return *m_functions[m_functionIndex.at(name)];
 }
 
 const Function& Reflect::fragment(size_t i) const {
-  return m_entries.fragment.at(i);
+  return *m_functions[m_entries.fragment.at(i)];
 }
 
 const Function& Reflect::vertex(size_t i) const {
-  return m_entries.vertex.at(i);
+  return *m_functions[m_entries.vertex.at(i)];
 }
 
 const Function& Reflect::compute(size_t i) const {
-  return m_entries.compute.at(i);
+  return *m_functions[m_entries.compute.at(i)];
+}
+
+void Reflect::detach() {
+  // the tree refers to the parser
+  m_tree.reset();
+  m_parser.reset();
+  m_source.reset();
+}
+
+namespace {
+/// Heap size of a subtree and its slot in the parent's child array on 64 bit
+/// platforms. Small leaves are stored inline, so this errs on the high side.
+constexpr size_t nodeBytes = 88;
+
+size_t countNodes(cppts::Node node) {
+  size_t count = 1;
+  for (auto child : node.children()) {
+    count += countNodes(child);
+  }
+  return count;
+}
+
+size_t heapSize(const std::string& s) {
+  // short strings are stored inline
+  return s.capacity() > std::string{}.capacity() ? s.capacity() + 1 : 0;
+}
+
+size_t heapSize(size_t /*value*/) { return 0; }
+
+size_t heapSize(const std::pair<size_t, size_t>& /*value*/) { return 0; }
+
+template <typename T>
+size_t heapSize(const std::vector<T>& items);
+
+template <typename T>
+size_t heapSize(const std::shared_ptr<const T>& record);
+
+size_t heapSize(const VertexAttribute& /*attribute*/) { return 0; }
+
+size_t heapSize(const VertexBufferLayout& layout) {
+  return heapSize(layout.attributes);
+}
+
+size_t heapSize(const InputAttribute& attribute) {
+  return heapSize(attribute.name) + heapSize(attribute.value);
+}
+
+size_t heapSize(const Input& input) {
+  return heapSize(input.name) + heapSize(input.type) +
+         heapSize(input.attributes);
+}
+
+size_t heapSize(const Structure& structure) {
+  return heapSize(structure.name) + heapSize(structure.members);
+}
+
+size_t heapSize(const Function& function) {
+  return heapSize(function.name) + heapSize(function.inputs) +
+         heapSize(function.attributes) + heapSize(function.returnType) +
+         heapSize(function.outputs) +
+         (function.vertexBuffers ? heapSize(*function.vertexBuffers) : 0);
+}
+
+size_t heapSize(const Binding& binding) {
+  return heapSize(binding.name) + heapSize(binding.bindingType) +
+         heapSize(binding.type) + heapSize(binding.addressSpace) +
+         heapSize(binding.accessMode) + heapSize(binding.sampleType) +
+         heapSize(binding.viewDimension) + heapSize(binding.texelFormat);
+}
+
+size_t heapSize(const BindGroup& group) { return heapSize(group.bindings()); }
+
+template <typename T>
+size_t heapSize(const std::shared_ptr<const T>& record) {
+  // shared records count in full for every reflection holding them
+  return sizeof(T) + heapSize(*record);
+}
+
+template <typename T>
+size_t heapSize(const std::vector<T>& items) {
+  size_t size = items.capacity() * sizeof(T);
+  for (const auto& item : items) {
+    size += heapSize(item);
+  }
+  return size;
+}
+
+template <typename Key, typename Value>
+size_t heapSize(const std::unordered_map<Key, Value>& map) {
+  // one node per element with the cached hash and the next pointer
+  size_t size = map.bucket_count() * sizeof(void*) +
+                map.size() * (sizeof(std::pair<const Key, Value>) +
+                              2 * sizeof(void*));
+  for (const auto& [key, value] : map) {
+    size += heapSize(key) + heapSize(value);
+  }
+  return size;
+}
+}  // namespace
+
+MemoryUsage Reflect::memoryUsage() const {
+  MemoryUsage usage;
+  if (m_source) {
+    usage.source = heapSize(*m_source);
+  }
+  if (m_tree) {
+    usage.tree = countNodes(m_tree->rootNode()) * nodeBytes;
+  }
+  usage.parser = m_parser != nullptr;
+  usage.model = heapSize(m_functions) + heapSize(m_functionIndex) +
+                heapSize(m_structures) + heapSize(m_structureIndex) +
+                heapSize(m_bindGroups) + heapSize(m_bindingIndex) +
+                heapSize(m_constants) + heapSize(m_entries.vertex) +
+                heapSize(m_entries.fragment) + heapSize(m_entries.compute);
+  return usage;
 }
 
+Reflect::Reflect(Reflect&& other) noexcept = default;
+Reflect& Reflect::operator=(Reflect&& other) noexcept = default;
+
 Reflect::~Reflect() = default;
 
 namespace {
+/// Add an attribute of an input or output to it, with its typed value
+void parseAttribute(Input& input, cppts::Node attribute) {
+  auto name = attribute.namedChild(0).str();
+  auto value = attribute.namedChild(1).str();
+  input.attributes.push_back(
+      InputAttribute{std::string{name}, std::string{value}});
+
+  if (name == "builtin") {
+    for (const auto& [builtinName, builtin] : builtins) {
+      if (builtinName == value) {
+        input.builtin = builtin;
+      }
+    }
+  } else if (name == "interpolate") {
+    static const std::unordered_map<std::string_view, InterpolationType>
+        types = {{"perspective", InterpolationType::Perspective},
+                 {"linear", InterpolationType::Linear},
+                 {"flat", InterpolationType::Flat}};
+    static const std::unordered_map<std::string_view, InterpolationSampling>
+        samplings = {{"center", InterpolationSampling::Center},
+                     {"centroid", InterpolationSampling::Centroid},
+                     {"sample", InterpolationSampling::Sample},
+                     {"first", InterpolationSampling::First},
+                     {"either", InterpolationSampling::Either}};
+    if (auto type = types.find(value); type != types.end()) {
+      input.interpolation = Interpolation{type->second, std::nullopt};
+      if (attribute.namedChildCount() > 2) {
+        auto sampling = samplings.find(attribute.namedChild(2).str());
+        if (sampling != samplings.end()) {
+          input.interpolation->sampling = sampling->second;
+        }
+      }
+    }
+  }
+}
+
 Input parseInput(cppts::Node node) {
   Input input;
   bool haveName = false;
   for (auto pchild : node.namedChildren()) {
-    if (pchild.type() == "variable_identifier_declaration"s) {
+    if (auto idecl = ast::VariableIdentifierDeclaration::cast(pchild); idecl) {
       haveName = true;
-      input.name = pchild.child("name").str();
-      input.type = pchild.child("type").str();
-    } else if (pchild.type() == "attribute"s) {
-      input.attributes.push_back(
-          InputAttribute{std::string{pchild.namedChild(0).str()},
-                         std::string{pchild.namedChild(1).str()}});
+      input.name = idecl->name().str();
+      input.type = idecl->type().str();
+    } else if (pchild.is(ast::symbol::attribute)) {
+      parseAttribute(input, pchild);
     }
   }
   assert(haveName && "Did not find input name");
+  evaluateLocation(input, {});
   return input;
 }
 }  // namespace
@@ -154,127 +969,184 @@ Input parseInput(cppts::Node node) {
 Function::Function(
     cppts::Node node,
     std::function<std::optional<Structure>(const std::string&)> structLookup) {
-  if (node.type() != "function_declaration"s) {
+  auto decl = ast::FunctionDeclaration::cast(node);
+  if (!decl) {
     throw std::invalid_argument{"Given node is not a function declaration"};
   }
-  name = node.child("name").str();
+  name = decl->name().str();
+  location = locate(node);
 
-  for (auto child : node.namedChildren()) {
-    if (child.type() == "attribute"s) {
-      std::string attrib_name{child.namedChild(0).str()};
-      std::string value;
-      for (auto next = child.namedChild(0).nextSibling(); !next.isNull();
-           next = next.nextSibling()) {
-        if (next.str() == "("s || next.str() == ")"s) {
-          continue;
-        }
-        value += next.str();
+  for (auto attribute : decl->attributes()) {
+    std::string value;
+    bool pastName = false;
+    for (auto next : attribute.node().children()) {
+      if (!pastName) {
+        pastName = next.isNamed();
+        continue;
       }
-      attributes.emplace(attrib_name, value);
-    } else if (child.type() == "parameter_list"s) {
-      for (auto param : child.namedChildren()) {
-        inputs.push_back(parseInput(param));
-        if (!structLookup) {
-          continue;
-        }
-        if (auto _struct = structLookup(inputs.back().type); _struct) {
-          inputs.pop_back();
-          for (auto member : _struct->members) {
-            inputs.push_back(member);
-          }
+      if (next.str() == "("s || next.str() == ")"s) {
+        continue;
+      }
+      value += next.str();
+    }
+    std::string_view key = attributeName(attribute);
+    if (key == "vertex") {
+      stage = Stage::Vertex;
+    } else if (key == "fragment") {
+      stage = Stage::Fragment;
+    } else if (key == "compute") {
+      stage = Stage::Compute;
+    } else if (key == "workgroup_size") {
+      workgroupSize = evaluateWorkgroupSize(value, {});
+    }
+    attributes.push_back(InputAttribute{std::string{key}, value});
+  }
+
+  if (auto parameters = decl->parameterList(); parameters) {
+    for (auto param : parameters->parameters()) {
+      inputs.push_back(parseInput(param.node()));
+      if (!structLookup) {
+        continue;
+      }
+      if (auto _struct = structLookup(inputs.back().type); _struct) {
+        inputs.pop_back();
+        for (auto member : _struct->members) {
+          inputs.push_back(member);
         }
       }
     }
   }
+
+  if (auto result = decl->type(); result) {
+    Input output;
+    if (auto tdecl = result->typeDeclaration(); tdecl) {
+      output.type = tdecl->str();
+    }
+    for (auto attribute : result->attributes()) {
+      parseAttribute(output, attribute.node());
+    }
+    evaluateLocation(output, {});
+    returnType = output.type;
+
+    std::optional<Structure> _struct;
+    if (structLookup) {
+      _struct = structLookup(returnType);
+    }
+    if (_struct) {
+      outputs = _struct->members;
+    } else {
+      outputs.push_back(std::move(output));
+    }
+  }
+
+  fingerprint = functionFingerprint(*this);
 }
 std::optional<std::string_view> Function::attribute(
     const std::string& attrib_name) const {
-  if (auto it = attributes.find(attrib_name); it != attributes.end()) {
-    return it->second;
+  for (const auto& attribute : attributes) {
+    if (attribute.name == attrib_name) {
+      return attribute.value;
+    }
   }
   return std::nullopt;
 }
 
 Structure::Structure(cppts::Node node) {
-  if (node.type() != "struct_declaration"s) {
+  auto decl = ast::StructDeclaration::cast(node);
+  if (!decl) {
     throw std::invalid_argument{"Given node is not a struct declaration"};
   }
 
-  name = node.child("name").str();
+  name = decl->name().str();
+  location = locate(node);
 
-  for (auto child : node.namedChildren()) {
-    if (child.type() != "struct_member"s) {
-      continue;
-    }
-    members.push_back(parseInput(child));
+  for (auto member : decl->structMembers()) {
+    members.push_back(parseInput(member.node()));
   }
 }
 
-Binding::Binding(cppts::Node node) {
-  if (node.type() != "global_variable_declaration"s) {
+Binding::Binding(cppts::Node node, const detail::Constants& constants) {
+  auto decl = ast::GlobalVariableDeclaration::cast(node);
+  if (!decl) {
     throw std::invalid_argument{
         "Given node is not a global struct declaration"};
   }
+  location = locate(node);
 
-  for (auto child : node.namedChildren()) {
-    if (child.type() == "attribute"s) {
-      std::string identifier{child.namedChild(0).str()};
-      if (identifier == "binding") {
-        auto vnode = child.namedChild(1);
-        if (vnode.type() != "int_literal"s) {
-          throw std::domain_error{identifier + " value of type"s +
-                                  vnode.type() + " unsupported"};
-        }
-        binding = std::stoi(std::string{vnode.str()});
-      } else if (identifier == "group") {
-        auto vnode = child.namedChild(1);
-        if (vnode.type() != "int_literal"s) {
-          throw std::domain_error{identifier + " value of type"s +
-                                  vnode.type() + " unsupported"};
+  for (auto attribute : decl->attributes()) {
+    std::string identifier{attributeName(attribute)};
+    if (identifier != "binding" && identifier != "group") {
+      continue;
+    }
+    auto expression = attribute.node().namedChild(1).str();
+    auto value = evaluateIndex(expression, constants);
+    // UNSET marks missing numbers
+    if (!value || *value >= UNSET) {
+      throw std::domain_error{identifier + " value " + std::string{expression} +
+                              " unsupported"};
+    }
+    if (identifier == "binding") {
+      binding = *value;
+    } else {
+      group = *value;
+    }
+  }
+
+  if (auto var = decl->variableDeclaration(); var) {
+    if (auto qual = var->variableQualifier(); qual) {
+      if (auto address_space = qual->addressSpace(); address_space) {
+        if (address_space->str() == "uniform" ||
+            address_space->str() == "storage") {
+          bindingType = "buffer";
+          addressSpace = address_space->str();
+        } else {
+          throw std::domain_error{"Unknown address_space: " +
+                                  std::string{address_space->str()}};
         }
-        group = std::stoi(std::string{vnode.str()});
       }
-    } else if (child.type() == "variable_declaration"s) {
-      if (auto qual = child.firstChildOfType("variable_qualifier"); qual) {
-        if (auto address_space = qual->namedChild(0);
-            address_space && address_space.type() == "address_space"s) {
-          if (address_space.str() == "uniform" ||
-              address_space.str() == "storage") {
-            bindingType = "buffer";
-          } else {
-            throw std::domain_error{"Unknown address_space: " +
-                                    std::string{address_space.str()}};
-          }
-        }
 
-        if (qual->namedChildCount() > 1) {
-          if (auto access_mode = qual->namedChild(1);
-              access_mode && access_mode.type() == "access_mode"s) {
-            // @TODO: Do something with this info
-          }
-        }
+      if (auto access_mode = qual->accessMode(); access_mode) {
+        accessMode = access_mode->str();
       }
-      if (auto idecl =
-              child.firstChildOfType("variable_identifier_declaration");
-          idecl) {
-        name = idecl->child("name").str();
-        auto tdecl = idecl->child("type");
-        if (bindingType ==
-            "") {  // no bindingType yet, pick bindingType from type decl
-          assert(tdecl.namedChildCount() == 0 &&
-                 "Type decl for builtin type expected");
-          std::string ptype{tdecl.str()};
-          static const std::regex type_regex{"^(\\w+) ?(?:<(\\w+)>)?$"};
-          std::smatch match;
-          if (!std::regex_match(ptype, match, type_regex)) {
-            throw std::domain_error{"Unable to parse type decl: " + ptype};
-          }
-          bindingType = match[1].str();
-          type = bindingType;
+    }
+    if (auto idecl = var->variableIdentifierDeclaration(); idecl) {
+      name = idecl->name().str();
+      auto tdecl = idecl->type();
+      if (bindingType ==
+          "") {  // no bindingType yet, pick bindingType from type decl
+        assert(tdecl.node().namedChildCount() == 0 &&
+               "Type decl for builtin type expected");
+        std::string ptype{tdecl.str()};
+        static const std::regex type_regex{
+            "^(\\w+)\\s*(?:<\\s*(\\w+)\\s*(?:,\\s*(\\w+)\\s*)?>)?$"};
+        std::smatch match;
+        if (!std::regex_match(ptype, match, type_regex)) {
+          throw std::domain_error{"Unable to parse type decl: " + ptype};
+        }
+        bindingType = match[1].str();
+        type = bindingType;
+        if (bindingType.starts_with("texture_storage_")) {
+          texelFormat = match[2].str();
+          accessMode = match[3].str();
         } else {
-          auto identifier = tdecl.namedChild(0);
-          type = identifier.str();
+          sampleType = match[2].str();
+        }
+        if (bindingType.starts_with("texture_") &&
+            bindingType != "texture_external") {
+          // texture_[storage_][depth_][multisampled_]<dimension>
+          std::string_view dimension{bindingType};
+          dimension.remove_prefix("texture_"sv.size());
+          for (auto prefix : {"storage_"sv, "depth_"sv, "multisampled_"sv}) {
+            if (dimension.starts_with(prefix)) {
+              multisampled = multisampled || prefix == "multisampled_";
+              dimension.remove_prefix(prefix.size());
+            }
+          }
+          viewDimension = dimension;
         }
+      } else {
+        auto identifier = tdecl.node().namedChild(0);
+        type = identifier.str();
       }
     }
   }
@@ -286,104 +1158,169 @@ Binding::Binding(cppts::Node node) {
   assert(type != "" && "Type was not found");
 }
 
-void to_json(json& j, const Reflect& reflect) {
-  j["structures"] = json::object();
-  for (const auto& [key, structure] : reflect.structures()) {
-    j["structures"][key] = structure;
+template <typename BasicJson>
+void to_json(BasicJson& j, const Reflect& reflect) {
+  j["structures"] = BasicJson::object();
+  for (const auto& structure : reflect.structures()) {
+    j["structures"][structure.name] = structure;
   }
 
-  j["functions"] = json::object();
-  for (const auto& [key, func] : reflect.functions()) {
-    j["functions"][key] = func;
+  j["functions"] = BasicJson::object();
+  for (const auto& func : reflect.functions()) {
+    j["functions"][func.name] = func;
   }
-  j["entries"] = json::object({{"vertex", json::array()},
-                               {"fragment", json::array()},
-                               {"compute", json::array()}});
+  j["entries"] = BasicJson::object({{"vertex", BasicJson::array()},
+                                    {"fragment", BasicJson::array()},
+                                    {"compute", BasicJson::array()}});
 
   auto entries = [&](const std::string& name, const auto& items) {
-    for (const auto& entry : items) {
-      const Function& func = entry;
-      j["entries"][name].push_back(func.name);
+    for (size_t index : items) {
+      j["entries"][name].push_back(reflect.functions()[index].name);
     }
   };
   entries("vertex", reflect.entries().vertex);
   entries("fragment", reflect.entries().fragment);
   entries("compute", reflect.entries().compute);
 
-  j["bindgroups"] = json::array();
+  j["bindgroups"] = BasicJson::array();
   for (const auto& bindGroup : reflect.bindGroups()) {
-    if (bindGroup.has_value()) {
-      j["bindgroups"].push_back(*bindGroup);
-    } else {
-      j["bindgroups"].push_back(nullptr);
-    }
+    j["bindgroups"].push_back(bindGroup);
   }
+  // hex, as JSON numbers are not exact beyond 53 bits in many consumers
+  char fingerprint[17];
+  std::snprintf(fingerprint, sizeof(fingerprint), "%016llx",
+                static_cast<unsigned long long>(reflect.fingerprint()));
+  j["fingerprint"] = fingerprint;
 }
 
-void to_json(json& j, const Structure& structure) {
+template <typename BasicJson>
+void to_json(BasicJson& j, const Structure& structure) {
   j["name"] = structure.name;
   j["members"] = structure.members;
+  j["location"] = structure.location;
 }
 
-void to_json(json& j, const Input& input) {
+template <typename BasicJson>
+void to_json(BasicJson& j, const Input& input) {
   j["name"] = input.name;
   j["type"] = input.type;
   j["attributes"] = input.attributes;
+  if (input.location) {
+    j["attributes"]["location"] = *input.location;
+  }
 }
 
-void to_json(json& j, const std::vector<Input>& inputs) {
-  j = json::array();
+template <typename BasicJson>
+void to_json(BasicJson& j, const std::vector<Input>& inputs) {
+  j = BasicJson::array();
   for (const auto& input : inputs) {
     j.push_back(input);
   }
 }
 
-void to_json(nlohmann::json& j, const InputAttribute& attribute) {
-  //  j["name"] = attribute.name;
-  if (attribute.name == "location") {
-    j = std::stoi(attribute.value);
-  } else {
-    j = attribute.value;
-  }
+template <typename BasicJson>
+void to_json(BasicJson& j, const InputAttribute& attribute) {
+  j = attribute.value;
 }
 
-void to_json(nlohmann::json& j, const std::vector<InputAttribute>& attributes) {
-  j = json::object();
+template <typename BasicJson>
+void to_json(BasicJson& j, const std::vector<InputAttribute>& attributes) {
+  j = BasicJson::object();
   for (const auto& attribute : attributes) {
     j[attribute.name] = attribute;
   }
 }
 
-void to_json(nlohmann::json& j, const Function& function) {
+template <typename BasicJson>
+void to_json(BasicJson& j, const Function& function) {
   j["name"] = function.name;
   j["inputs"] = function.inputs;
-  j["attributes"] = json::object();
-  for (auto& [key, value] : function.attributes) {
+  if (!function.returnType.empty()) {
+    j["returnType"] = function.returnType;
+    j["outputs"] = function.outputs;
+  }
+  j["attributes"] = BasicJson::object();
+  for (const auto& [key, value] : function.attributes) {
+    if (j["attributes"].contains(key)) {
+      continue;
+    }
     if (value == "") {
       j["attributes"][key] = true;
     } else {
       j["attributes"][key] = value;
     }
   }
+  if (function.workgroupSize) {
+    j["workgroupSize"] = *function.workgroupSize;
+  }
+  if (function.vertexBuffers) {
+    j["vertexBuffers"] = BasicJson::array();
+    for (const auto& layout : *function.vertexBuffers) {
+      j["vertexBuffers"].push_back(layout);
+    }
+  }
+  j["location"] = function.location;
 }
 
-void to_json(nlohmann::json& j, const BindGroup& bindGroup) {
-  j = json::array();
+template <typename BasicJson>
+void to_json(BasicJson& j, const BindGroup& bindGroup) {
+  j["group"] = bindGroup.group();
+  j["bindings"] = BasicJson::array();
   for (const auto& binding : bindGroup.bindings()) {
-    if (binding.has_value()) {
-      j.push_back(*binding);
-    } else {
-      j.push_back(nullptr);
-    }
+    j["bindings"].push_back(binding);
   }
 }
 
-void to_json(nlohmann::json& j, const Binding& binding) {
+template <typename BasicJson>
+void to_json(BasicJson& j, const Binding& binding) {
   j["binding"] = binding.binding;
   j["group"] = binding.group;
   j["name"] = binding.name;
   j["bindingType"] = binding.bindingType;
   j["type"] = binding.type;
+  if (!binding.addressSpace.empty()) {
+    j["addressSpace"] = binding.addressSpace;
+  }
+  if (!binding.accessMode.empty()) {
+    j["accessMode"] = binding.accessMode;
+  }
+  if (!binding.sampleType.empty()) {
+    j["sampleType"] = binding.sampleType;
+  }
+  if (!binding.viewDimension.empty()) {
+    j["viewDimension"] = binding.viewDimension;
+  }
+  if (binding.multisampled) {
+    j["multisampled"] = true;
+  }
+  if (!binding.texelFormat.empty()) {
+    j["texelFormat"] = binding.texelFormat;
+  }
+  j["location"] = binding.location;
 }
 
+template <typename BasicJson>
+void to_json(BasicJson& j, const SourceLocation& location) {
+  j["offset"] = location.offset;
+  j["line"] = location.line;
+  j["column"] = location.column;
+}
+
+#define WGSL_REFLECT_INSTANTIATE_TO_JSON(BasicJson)                          \
+  template void to_json(BasicJson&, const SourceLocation&);                  \
+  template void to_json(BasicJson&, const InputAttribute&);                  \
+  template void to_json(BasicJson&, const std::vector<InputAttribute>&);     \
+  template void to_json(BasicJson&, const Input&);                           \
+  template void to_json(BasicJson&, const std::vector<Input>&);              \
+  template void to_json(BasicJson&, const Structure&);                       \
+  template void to_json(BasicJson&, const Function&);                        \
+  template void to_json(BasicJson&, const Binding&);                         \
+  template void to_json(BasicJson&, const BindGroup&);                       \
+  template void to_json(BasicJson&, const Reflect&);
+
+WGSL_REFLECT_INSTANTIATE_TO_JSON(nlohmann::json)
+WGSL_REFLECT_INSTANTIATE_TO_JSON(nlohmann::ordered_json)
+
+#undef WGSL_REFLECT_INSTANTIATE_TO_JSON
+
 }  // namespace wgsl_reflect
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "wgsl_reflect/server.hpp"
+
+#include "wgsl_reflect/layout.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace nlohmann;
+
+namespace wgsl_reflect {
+
+namespace {
+// JSON-RPC 2.0 error codes
+constexpr int PARSE_ERROR = -32700;
+constexpr int INVALID_REQUEST = -32600;
+constexpr int METHOD_NOT_FOUND = -32601;
+constexpr int INVALID_PARAMS = -32602;
+constexpr int REFLECT_ERROR = -32000;
+
+struct RpcError : std::runtime_error {
+  RpcError(int _code, const std::string& message)
+      : std::runtime_error{message}, code{_code} {}
+
+  int code;
+};
+
+std::string errorResponse(const json& id, int code,
+                          const std::string& message) {
+  json response = {{"jsonrpc", "2.0"},
+                   {"id", id},
+                   {"error", {{"code", code}, {"message", message}}}};
+  return response.dump();
+}
+
+/// Apply `edit` to `text` and add it to `edits`, the edits that turned the
+/// text of the last model into `text`. They stay sorted, disjoint and
+/// relative to that text, so that one variant applies them all.
+void applyEdit(std::string& text, const json& edit,
+               std::vector<SourceEdit>& edits) {
+  if (!edit.is_object() || !edit.contains("start") ||
+      !edit.contains("end") || !edit.contains("text")) {
+    throw RpcError{INVALID_PARAMS, "Edit needs start, end and text"};
+  }
+  auto start = edit["start"].get<size_t>();
+  auto end = edit["end"].get<size_t>();
+  if (start > end || end > text.size()) {
+    throw RpcError{INVALID_PARAMS, "Edit range out of bounds"};
+  }
+  auto replacement = edit["text"].get<std::string>();
+
+  auto growth = [](const SourceEdit& e) {
+    return static_cast<ptrdiff_t>(e.text.size()) -
+           static_cast<ptrdiff_t>(e.end - e.start);
+  };
+  // earlier edits touching [start, end) in `text` are merged into this one
+  ptrdiff_t delta = 0;
+  size_t first = 0;
+  while (first < edits.size() &&
+         edits[first].start + delta + edits[first].text.size() < start) {
+    delta += growth(edits[first++]);
+  }
+  ptrdiff_t before = delta;
+  size_t mergedStart = start;
+  size_t mergedEnd = end;
+  size_t last = first;
+  while (last < edits.size() && edits[last].start + delta <= end) {
+    size_t editStart = edits[last].start + delta;
+    mergedStart = std::min(mergedStart, editStart);
+    mergedEnd = std::max(mergedEnd, editStart + edits[last].text.size());
+    delta += growth(edits[last++]);
+  }
+
+  SourceEdit merged{mergedStart - before, mergedEnd - delta,
+                    text.substr(mergedStart, start - mergedStart) +
+                        replacement + text.substr(end, mergedEnd - end)};
+  edits.erase(edits.begin() + first, edits.begin() + last);
+  edits.insert(edits.begin() + first, std::move(merged));
+  text.replace(start, end - start, replacement);
+}
+}  // namespace
+
+Server::Server(const Reflect::Options& options) : m_options{options} {}
+
+Server::Document& Server::document(const json& params) {
+  if (!params.contains("uri") || !params["uri"].is_string()) {
+    throw RpcError{INVALID_PARAMS, "Missing document uri"};
+  }
+  auto uri = params["uri"].get<std::string>();
+  auto it = m_documents.find(uri);
+  if (it == m_documents.end()) {
+    throw RpcError{INVALID_PARAMS, "Document " + uri + " is not open"};
+  }
+  return it->second;
+}
+
+const std::string& Server::result(const std::string& method,
+                                  const json& params) {
+  auto& doc = document(params);
+  if (auto it = doc.results.find(method); it != doc.results.end()) {
+    return it->second;
+  }
+
+  if (!doc.model) {
+    try {
+      doc.model.emplace(doc.text, m_options);
+    } catch (const std::exception& e) {
+      throw RpcError{REFLECT_ERROR, e.what()};
+    }
+  }
+
+  ordered_json j = *doc.model;
+  ordered_json value;
+  if (method == "reflect") {
+    value = std::move(j);
+  } else if (method == "entryPoints") {
+    value = std::move(j["entries"]);
+  } else if (method == "layout") {
+    value = ordered_json::array();
+    for (const auto& layout : bindGroupLayouts(*doc.model)) {
+      value.push_back(layout);
+    }
+  } else if (method == "vertexBuffers") {
+    // null for entry points whose inputs are no vertex attributes
+    value = ordered_json::object();
+    for (const auto& name : j["entries"]["vertex"]) {
+      value[name.get<std::string>()] =
+          j["functions"][name.get<std::string>()].value("vertexBuffers",
+                                                        ordered_json{});
+    }
+  } else {
+    // bindings: flat list in group and binding order
+    value = ordered_json::array();
+    for (const auto& group : j["bindgroups"]) {
+      for (const auto& binding : group["bindings"]) {
+        value.push_back(binding);
+      }
+    }
+  }
+  return doc.results.emplace(method, value.dump()).first->second;
+}
+
+std::optional<std::string> Server::handle(std::string_view line) {
+  json request = json::parse(line, nullptr, false);
+  if (request.is_discarded()) {
+    return errorResponse(nullptr, PARSE_ERROR, "Parse error");
+  }
+  if (!request.is_object()) {
+    return errorResponse(nullptr, INVALID_REQUEST, "Invalid request");
+  }
+
+  bool notification = !request.contains("id");
+  json id = notification ? json{} : request["id"];
+
+  try {
+    if (!request.contains("method") || !request["method"].is_string()) {
+      throw RpcError{INVALID_REQUEST, "Invalid request"};
+    }
+    auto method = request["method"].get<std::string>();
+    json params = request.value("params", json::object());
+    if (!params.is_object()) {
+      throw RpcError{INVALID_PARAMS, "Params have to be an object"};
+    }
+
+    const std::string* value = nullptr;
+    static const std::string null = "null";
+    if (method == "open" || method == "change") {
+      if (!params.contains("uri") || !params["uri"].is_string()) {
+        throw RpcError{INVALID_PARAMS, "Missing document uri"};
+      }
+      auto uri = params["uri"].get<std::string>();
+      if (method == "change") {
+        document(params);
+      }
+
+      Document doc;
+      if (params.contains("text")) {
+        doc.text = params["text"].get<std::string>();
+      } else if (method == "change" && params.contains("edits")) {
+        auto& old = document(params);
+        doc.text = old.text;
+        std::vector<SourceEdit> edits;
+        for (const auto& edit : params["edits"]) {
+          applyEdit(doc.text, edit, edits);
+        }
+        if (old.model) {
+          try {
+            doc.model = old.model->variant(edits);
+          } catch (const std::exception&) {
+            // reported by the next request on the document
+            doc.model.reset();
+          }
+        }
+      } else {
+        throw RpcError{INVALID_PARAMS, "Missing document text"};
+      }
+      m_documents.insert_or_assign(uri, std::move(doc));
+      value = &null;
+    } else if (method == "close") {
+      document(params);
+      m_documents.erase(params["uri"].get<std::string>());
+      value = &null;
+    } else if (method == "reflect" || method == "bindings" ||
+               method == "entryPoints" || method == "layout" ||
+               method == "vertexBuffers") {
+      value = &result(method, params);
+    } else {
+      throw RpcError{METHOD_NOT_FOUND, "Method " + method + " not found"};
+    }
+
+    if (notification) {
+      return std::nullopt;
+    }
+    // splice the serialized result in instead of building a json response
+    return R"({"id":)" + id.dump() + R"(,"jsonrpc":"2.0","result":)" + *value +
+           "}";
+  } catch (const RpcError& e) {
+    if (notification) {
+      return std::nullopt;
+    }
+    return errorResponse(id, e.code, e.what());
+  } catch (const json::exception& e) {
+    if (notification) {
+      return std::nullopt;
+    }
+    return errorResponse(id, INVALID_PARAMS, e.what());
+  } catch (const std::exception& e) {
+    // e.g. out of memory building a result, the server keeps running
+    if (notification) {
+      return std::nullopt;
+    }
+    return errorResponse(id, REFLECT_ERROR, e.what());
+  }
+}
+
+void Server::run(std::istream& in, std::ostream& out) {
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    if (auto response = handle(line); response) {
+      out << *response << '\n' << std::flush;
+    }
+  }
+}
+
+}  // namespace wgsl_reflect
@@ -0,0 +1,310 @@
+// Generates typed wrappers for the nodes of the WGSL grammar from the
+// node-types.json shipped with tree-sitter-wgsl. Symbol and field ids are
+// resolved against the compiled grammar, so the generated header matches the
+// parser that is linked into wgsl_reflect.
+//
+// usage: generate_ast <node-types.json> <output header>
+
+#include "cppts/language.hpp"
+#include <tree_sitter_wgsl.h>
+
+#include <nlohmann/json.hpp>
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using nlohmann::json;
+
+namespace {
+
+const std::set<std::string> cppKeywords = {
+    "alignas",  "alignof",  "and",      "asm",       "auto",     "bool",
+    "break",    "case",     "catch",    "char",      "class",    "const",
+    "continue", "default",  "delete",   "do",        "double",   "else",
+    "enum",     "explicit", "export",   "extern",    "false",    "float",
+    "for",      "friend",   "goto",     "if",        "inline",   "int",
+    "long",     "mutable",  "namespace", "new",      "not",      "operator",
+    "or",       "private",  "protected", "public",   "register", "return",
+    "short",    "signed",   "sizeof",   "static",    "struct",   "switch",
+    "template", "this",     "throw",    "true",      "try",      "typedef",
+    "typename", "union",    "unsigned", "using",     "virtual",  "void",
+    "volatile", "while",    "xor"};
+
+// Names every wrapper already uses for itself
+const std::set<std::string> reservedMembers = {"symbol", "cast", "node",
+                                               "str"};
+
+std::string camel(const std::string& name, bool upper) {
+  std::string out;
+  bool next_upper = upper;
+  for (char c : name) {
+    if (c == '_') {
+      next_upper = !out.empty() || upper;
+      continue;
+    }
+    out += next_upper ? static_cast<char>(std::toupper(c)) : c;
+    next_upper = false;
+  }
+  return out;
+}
+
+std::string identifier(const std::string& name) {
+  if (cppKeywords.count(name) > 0 || reservedMembers.count(name) > 0) {
+    return name + "_";
+  }
+  return name;
+}
+
+std::string plural(const std::string& name) {
+  auto ends = [&](const std::string& suffix) {
+    return name.size() >= suffix.size() &&
+           name.compare(name.size() - suffix.size(), suffix.size(), suffix) ==
+               0;
+  };
+  if (ends("s") || ends("x") || ends("sh") || ends("ch")) {
+    return name + "es";
+  }
+  if (ends("y") && name.size() > 1 &&
+      std::string{"aeiou"}.find(name[name.size() - 2]) == std::string::npos) {
+    return name.substr(0, name.size() - 1) + "ies";
+  }
+  return name + "s";
+}
+
+struct Generator {
+  cppts::Language language{tree_sitter_wgsl()};
+  // named, concrete node types that get a wrapper class
+  std::set<std::string> wrapped;
+
+  // Wrapper class for a list of possible node types, or empty if the
+  // accessor has to return an untyped cppts::Node.
+  std::string wrapperFor(const json& types) const {
+    if (types.size() != 1 || !types[0]["named"].get<bool>()) {
+      return "";
+    }
+    auto type = types[0]["type"].get<std::string>();
+    if (wrapped.count(type) == 0) {
+      return "";
+    }
+    return camel(type, true);
+  }
+
+  void generate(const json& nodeTypes, std::ostream& os) {
+    for (const auto& node : nodeTypes) {
+      if (node["named"].get<bool>() && !node.contains("subtypes")) {
+        wrapped.insert(node["type"].get<std::string>());
+      }
+    }
+
+    std::set<std::string> fields;
+    for (const auto& node : nodeTypes) {
+      if (node.contains("fields")) {
+        for (const auto& [name, _] : node["fields"].items()) {
+          fields.insert(name);
+        }
+      }
+    }
+
+    os << "// Generated by generate_ast from the tree-sitter-wgsl "
+          "node-types.json.\n"
+          "// Do not edit.\n"
+          "#pragma once\n\n"
+          "#include \"cppts/language.hpp\"\n"
+          "#include \"cppts/node.hpp\"\n\n"
+          "#include <cassert>\n"
+          "#include <optional>\n"
+          "#include <string_view>\n\n"
+          "namespace wgsl_reflect::ast {\n\n";
+
+    os << "namespace symbol {\n";
+    for (const auto& type : wrapped) {
+      os << "inline constexpr cppts::Symbol " << identifier(type) << "{"
+         << language.symbol(type).id << "};\n";
+    }
+    os << "}  // namespace symbol\n\n";
+
+    os << "namespace field {\n";
+    for (const auto& name : fields) {
+      os << "inline constexpr cppts::Field " << identifier(name) << "{"
+         << language.field(name).id << "};\n";
+    }
+    os << "}  // namespace field\n\n";
+
+    for (const auto& type : wrapped) {
+      os << "class " << camel(type, true) << ";\n";
+    }
+    os << "\n";
+
+    std::stringstream definitions;
+    for (const auto& node : nodeTypes) {
+      auto type = node["type"].get<std::string>();
+      if (wrapped.count(type) == 0) {
+        continue;
+      }
+      generateClass(node, os, definitions);
+    }
+
+    os << definitions.str();
+    os << "}  // namespace wgsl_reflect::ast\n";
+  }
+
+  void generateClass(const json& node, std::ostream& os,
+                     std::ostream& definitions) {
+    auto type = node["type"].get<std::string>();
+    auto cls = camel(type, true);
+    std::set<std::string> members = reservedMembers;
+
+    os << "class " << cls << " {\n"
+       << " public:\n"
+       << "  static constexpr cppts::Symbol symbol = symbol::"
+       << identifier(type) << ";\n\n"
+       << "  explicit " << cls << "(cppts::Node node) : m_node{node} {\n"
+       << "    assert(node.is(symbol) && \"Node is not of type " << type
+       << "\");\n"
+       << "  }\n\n"
+       << "  static std::optional<" << cls << "> cast(cppts::Node node) {\n"
+       << "    if (!node.is(symbol)) {\n"
+       << "      return std::nullopt;\n"
+       << "    }\n"
+       << "    return " << cls << "{node};\n"
+       << "  }\n\n"
+       << "  cppts::Node node() const { return m_node; }\n\n"
+       << "  std::string_view str() const { return m_node.str(); }\n";
+
+    if (node.contains("fields")) {
+      for (const auto& [name, spec] : node["fields"].items()) {
+        auto accessor = identifier(camel(name, false));
+        members.insert(accessor);
+        auto wrapper = wrapperFor(spec["types"]);
+        auto field = "field::" + identifier(name);
+        bool multiple = spec["multiple"].get<bool>();
+        bool required = spec["required"].get<bool>();
+
+        if (multiple) {
+          auto range = wrapper.empty()
+                           ? std::string{"cppts::ChildRange"}
+                           : "cppts::TypedChildRange<" + wrapper + ">";
+          os << "\n  " << range << " " << accessor << "() const;\n";
+          definitions << "inline " << range << " " << cls
+                      << "::" << accessor << "() const {\n";
+          if (wrapper.empty()) {
+            definitions << "  return m_node.childrenOfField(" << field
+                        << ");\n";
+          } else {
+            definitions << "  return " << range << "{m_node, " << field
+                        << "};\n";
+          }
+          definitions << "}\n\n";
+          continue;
+        }
+
+        auto value = wrapper.empty() ? std::string{"cppts::Node"} : wrapper;
+        if (required) {
+          os << "\n  " << value << " " << accessor << "() const;\n";
+          definitions << "inline " << value << " " << cls << "::" << accessor
+                      << "() const {\n";
+          if (wrapper.empty()) {
+            definitions << "  return m_node.child(" << field << ");\n";
+          } else {
+            definitions << "  return " << wrapper << "{m_node.child(" << field
+                        << ")};\n";
+          }
+        } else {
+          os << "\n  std::optional<" << value << "> " << accessor
+             << "() const;\n";
+          definitions << "inline std::optional<" << value << "> " << cls
+                      << "::" << accessor << "() const {\n";
+          if (wrapper.empty()) {
+            definitions << "  return m_node.maybeChild(" << field << ");\n";
+          } else {
+            definitions << "  if (auto child = m_node.maybeChild(" << field
+                        << "); child) {\n"
+                        << "    return " << wrapper << "{*child};\n"
+                        << "  }\n"
+                        << "  return std::nullopt;\n";
+          }
+        }
+        definitions << "}\n\n";
+      }
+    }
+
+    if (node.contains("children")) {
+      for (const auto& child : node["children"]["types"]) {
+        if (!child["named"].get<bool>()) {
+          continue;
+        }
+        auto childType = child["type"].get<std::string>();
+        if (wrapped.count(childType) == 0) {
+          continue;
+        }
+        auto wrapper = camel(childType, true);
+        auto many = identifier(camel(plural(childType), false));
+        auto one = identifier(camel(childType, false));
+        if (members.count(many) > 0 || members.count(one) > 0) {
+          continue;
+        }
+        members.insert(many);
+        members.insert(one);
+
+        os << "\n  cppts::TypedChildRange<" << wrapper << "> " << many
+           << "() const;\n"
+           << "\n  std::optional<" << wrapper << "> " << one << "() const;\n";
+
+        definitions << "inline cppts::TypedChildRange<" << wrapper << "> "
+                    << cls << "::" << many << "() const {\n"
+                    << "  return cppts::TypedChildRange<" << wrapper
+                    << ">{m_node};\n"
+                    << "}\n\n"
+                    << "inline std::optional<" << wrapper << "> " << cls
+                    << "::" << one << "() const {\n"
+                    << "  if (auto child = m_node.firstChildOfType(" << wrapper
+                    << "::symbol); child) {\n"
+                    << "    return " << wrapper << "{*child};\n"
+                    << "  }\n"
+                    << "  return std::nullopt;\n"
+                    << "}\n\n";
+      }
+    }
+
+    os << "\n private:\n"
+       << "  cppts::Node m_node;\n"
+       << "};\n\n";
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::cerr << "usage: " << argv[0] << " <node-types.json> <output header>"
+              << std::endl;
+    return 1;
+  }
+
+  json nodeTypes;
+  {
+    std::ifstream ifs{argv[1]};
+    if (!ifs) {
+      std::cerr << "Unable to open " << argv[1] << std::endl;
+      return 1;
+    }
+    ifs >> nodeTypes;
+  }
+
+  std::stringstream ss;
+  try {
+    Generator{}.generate(nodeTypes, ss);
+  } catch (const std::exception& e) {
+    std::cerr << "Unable to generate AST wrappers: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ofstream ofs{argv[2]};
+  ofs << ss.str();
+  return ofs.good() ? 0 : 1;
+}